@@ -0,0 +1,329 @@
+// batch_solve.cpp
+//
+// Solve a batch of boards of the codingame dataset (data/test*.json) within a total
+// time budget. The searches of all the boards are kept alive and interleaved: the
+// budget is cut into slices, handed out by a bandit to the boards whose best score
+// improved the most lately (see BatchScheduler), or to each board in turn with
+// --schedule round-robin. A search whose tree didn't improve for --restart-after
+// slices starts over with a new tree (0 to never restart): the scores reached by
+// independent searches vary a lot, the best of several short ones usually beats a
+// long one.
+//
+// With --checkpoint, the best sequence of each board is saved to the file as it
+// improves, one line per board: "BOARD SCORE x,y x,y ..." in codingame coordinates.
+// The sequences of an existing checkpoint are loaded first, and only replaced by
+// better ones.
+//
+// The results are written in CSV on stdout.
+//
+// Usage: batch_solve [--data DIR] [--boards FIRST-LAST] [--budget MS] [--slice MS]
+//                    [--schedule bandit|round-robin] [--restart-after N]
+//                    [--bandit-expl C] [--discount D] [--checkpoint FILE] [--seed S]
+//
+#include "samegame.h"
+#include "agents.h"
+#include "batch_scheduler.h"
+#include "corpus.h"
+#include "rand.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace sg;
+
+namespace {
+
+struct Config
+{
+  std::string data_dir = "../data";
+  int first_board = 1;
+  int last_board = 50;
+  unsigned int budget_ms = 60000;
+  unsigned int slice_ms = 100;
+  /** Restart the search of a board after that many slices without improvement. */
+  unsigned int restart_after = 5;
+  BatchScheduler::Config schedule{};
+  std::string checkpoint = "";
+  uint64_t seed = Rand::global_seed();
+};
+
+void usage(const char* prog)
+{
+  std::cerr << "Usage: " << prog
+            << " [--data DIR] [--boards FIRST-LAST] [--budget MS] [--slice MS]"
+               " [--schedule bandit|round-robin] [--restart-after N]"
+               " [--bandit-expl C] [--discount D] [--checkpoint FILE] [--seed S]\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << arg << '\n';
+      return false;
+    }
+    const std::string value = argv[++i];
+
+    if (arg == "--data")
+      config.data_dir = value;
+    else if (arg == "--boards")
+    {
+      auto dash = value.find('-');
+      config.first_board = std::stoi(value.substr(0, dash));
+      config.last_board =
+          dash == std::string::npos ? config.first_board : std::stoi(value.substr(dash + 1));
+    }
+    else if (arg == "--budget")
+      config.budget_ms = std::stoul(value);
+    else if (arg == "--slice")
+      config.slice_ms = std::max(1ul, std::stoul(value));
+    else if (arg == "--schedule" && (value == "bandit" || value == "round-robin"))
+      config.schedule.strategy = value == "bandit" ? BatchScheduler::Strategy::bandit
+                                                   : BatchScheduler::Strategy::round_robin;
+    else if (arg == "--restart-after")
+      config.restart_after = std::stoul(value);
+    else if (arg == "--bandit-expl")
+      config.schedule.expl_cst = std::stod(value);
+    else if (arg == "--discount")
+      config.schedule.discount = std::stod(value);
+    else if (arg == "--checkpoint")
+      config.checkpoint = value;
+    else if (arg == "--seed")
+      config.seed = std::stoull(value);
+    else
+    {
+      std::cerr << "Invalid option " << arg << ' ' << value << '\n';
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * The search of a board, which goes on slice after slice. The agent holds the
+ * state by reference, so the search doesn't move.
+ */
+struct Search
+{
+  Search(int _board, const State& _initial) : board(_board), initial(_initial) { restart(); }
+  Search(const Search&) = delete;
+
+  /** Start over with a new tree, keeping the best sequence. */
+  void restart()
+  {
+    p_mcts.reset();
+    state = initial;
+    p_mcts = std::make_unique<MctsAgent>(state);
+    configure(*p_mcts, 1.0);
+    n_stale_slices = 0;
+  }
+
+  int board;
+  const State initial;
+  State state;
+  std::unique_ptr<MctsAgent> p_mcts;
+
+  int best_score = -1;
+  std::vector<ClusterData> best_actions;
+  /** The best score of the current tree. */
+  int tree_score = -1;
+  unsigned int n_stale_slices = 0;
+  unsigned int n_slices = 0;
+  unsigned int n_restarts = 0;
+  double search_ms = 0.0;
+  uint64_t iterations = 0;
+  bool solved = false;
+};
+
+using Searches = std::vector<std::unique_ptr<Search>>;
+
+/** Load the sequences of the checkpoint which are valid on their board. */
+void load_checkpoint(const std::string& filename, Searches& searches)
+{
+  std::ifstream ifs(filename);
+  std::string line;
+  while (std::getline(ifs, line))
+  {
+    std::istringstream iss{line};
+    int board, score;
+    if (!(iss >> board >> score))
+      continue;
+    auto it = std::find_if(searches.begin(), searches.end(), [board](const auto& search) {
+      return search->board == board;
+    });
+    std::vector<ClusterData> actions;
+    if (it == searches.end() || !corpus::read_coordinates(iss, (*it)->initial, actions))
+    {
+      std::cerr << "Ignoring the checkpoint of board " << board << '\n';
+      continue;
+    }
+    (*it)->best_score = score_sequence((*it)->initial, actions);
+    (*it)->best_actions = std::move(actions);
+  }
+}
+
+/** Write the best sequences, replacing the file only once it is complete. */
+void save_checkpoint(const std::string& filename, const Searches& searches)
+{
+  const std::string tmp = filename + ".tmp";
+  {
+    std::ofstream ofs(tmp);
+    for (const auto& search : searches)
+    {
+      if (search->best_score < 0)
+        continue;
+      ofs << search->board << ' ' << search->best_score;
+      corpus::write_coordinates(ofs, search->best_actions);
+      ofs << '\n';
+    }
+    if (!ofs)
+    {
+      std::cerr << "Could not write the checkpoint " << tmp << '\n';
+      return;
+    }
+  }
+  std::rename(tmp.c_str(), filename.c_str());
+}
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                   - start)
+      .count();
+}
+
+struct SliceResult
+{
+  /** The improvement of the best score, in thousands of points, for the scheduler. */
+  double reward = 0.0;
+  /** Whether the best sequence changed, the first one included. */
+  bool improved = false;
+};
+
+/**
+ * Give a slice to the search. Restart it if its tree didn't improve for
+ * `restart_after` slices.
+ */
+SliceResult search_slice(Search& search, unsigned int slice_ms, unsigned int restart_after)
+{
+  const auto start = std::chrono::steady_clock::now();
+  MctsAgent& mcts = *search.p_mcts;
+  mcts.set_max_time(slice_ms);
+  mcts.run();
+  search.search_ms += ms_since(start);
+  search.iterations += mcts.get_iterations_cnt();
+  ++search.n_slices;
+  search.solved = mcts.is_solved();
+
+  auto actions = mcts.peek_best_sequence(MctsAgent::ActionSelection::by_n_visits);
+  const int score = score_sequence(search.initial, actions);
+  if (score > search.tree_score)
+  {
+    search.tree_score = score;
+    search.n_stale_slices = 0;
+  }
+  else if (restart_after > 0 && ++search.n_stale_slices >= restart_after && !search.solved)
+  {
+    search.restart();
+    search.tree_score = -1;
+    ++search.n_restarts;
+  }
+
+  if (score <= search.best_score)
+    return SliceResult{};
+  // The first slice only sets the reference.
+  const SliceResult ret{
+      .reward = search.best_score < 0 ? 0.0 : (score - search.best_score) / 1000.0,
+      .improved = true};
+  search.best_score = score;
+  search.best_actions = std::move(actions);
+  return ret;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  Rand::set_global_seed(config.seed);
+
+  Searches searches;
+  for (int i = config.first_board; i <= config.last_board; ++i)
+  {
+    State state;
+    const std::string filename = corpus::test_path(config.data_dir, i);
+    if (!corpus::read_test(filename, state))
+    {
+      std::cerr << "Could not read the board in " << filename << '\n';
+      return EXIT_FAILURE;
+    }
+    searches.push_back(std::make_unique<Search>(i, state));
+  }
+  if (searches.empty())
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (!config.checkpoint.empty())
+    load_checkpoint(config.checkpoint, searches);
+
+  std::cerr << "Solving " << searches.size() << " boards in " << config.budget_ms / 1000.0
+            << " seconds, by slices of " << config.slice_ms << " ms, seed " << config.seed
+            << '\n';
+
+  BatchScheduler scheduler(searches.size(), config.schedule);
+  const auto start = std::chrono::steady_clock::now();
+  auto last_save = start;
+  bool unsaved = false;
+  double elapsed_ms;
+  while ((elapsed_ms = ms_since(start)) < config.budget_ms && scheduler.n_active() > 0)
+  {
+    const size_t ndx = scheduler.next();
+    Search& search = *searches[ndx];
+    const auto slice_ms = std::min<double>(config.slice_ms, config.budget_ms - elapsed_ms);
+    const SliceResult result = search_slice(
+        search, std::max(1u, static_cast<unsigned int>(slice_ms)), config.restart_after);
+    scheduler.update(ndx, result.reward);
+    if (search.solved)
+      scheduler.retire(ndx);
+
+    // Save at most once a second.
+    unsaved = unsaved || result.improved;
+    if (!config.checkpoint.empty() && unsaved && ms_since(last_save) >= 1000.0)
+    {
+      save_checkpoint(config.checkpoint, searches);
+      last_save = std::chrono::steady_clock::now();
+      unsaved = false;
+    }
+  }
+  if (!config.checkpoint.empty())
+    save_checkpoint(config.checkpoint, searches);
+
+  std::cout << "board,score,slices,restarts,seconds,iterations,solved\n";
+  long total_score = 0;
+  for (const auto& search : searches)
+  {
+    std::cout << search->board << ',' << search->best_score << ',' << search->n_slices << ','
+              << search->n_restarts << ',' << search->search_ms / 1000.0 << ','
+              << search->iterations << ',' << search->solved << '\n';
+    total_score += std::max(search->best_score, 0);
+  }
+  std::cout << "total," << total_score << ",,,,," << '\n';
+  return EXIT_SUCCESS;
+}
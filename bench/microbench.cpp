@@ -0,0 +1,325 @@
+/// microbench.cpp
+///
+/// Timings of the game kernels, with Google Benchmark.
+///
+/// The inputs are boards of data/ played down to several fill levels by seeded
+/// random playouts, so that every run (and every commit) times the same grids.
+/// Use --benchmark_repetitions=N to get the variance of the results.
+///
+/// The `allocs` counters are the heap allocations per iteration, which should
+/// stay at zero for the kernels of the search.
+///
+#include "alloc_counter.h"
+#include "clusterhelper.h"
+#include "corpus.h"
+#include "rand.h"
+#include "region_graph.h"
+#include "samegame.h"
+#include "sghash.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef SG_DATA_DIR
+#define SG_DATA_DIR "../data"
+#endif
+
+namespace {
+
+using namespace sg;
+
+/** Boards of data/ of various shapes: patterns, random boards and few colors. */
+constexpr int BOARDS[] = {5, 11, 20};
+/** Percentages of the cells left on the board. */
+constexpr int FILL_LEVELS[] = {100, 75, 50, 25};
+constexpr uint64_t SEED = 2021;
+
+State load_board(int board)
+{
+  const std::string filename = corpus::test_path(SG_DATA_DIR, board);
+  State ret;
+  if (!corpus::read_test(filename, ret))
+    throw std::runtime_error("Could not read the board in " + filename);
+  return ret;
+}
+
+/**
+ * The board played down by random actions until at most `fill` percents of its
+ * cells are left (or it is terminal).
+ */
+const State& board_at(int board, int fill)
+{
+  static std::map<std::pair<int, int>, State> cache{};
+  auto it = cache.find({board, fill});
+  if (it != cache.end())
+    return it->second;
+
+  Rand::set_global_seed(SEED);
+  State state = load_board(board);
+  while (state.n_cells() * 100 > fill * MAX_CELLS && !state.is_terminal())
+    state.apply_random_action();
+  state.key();
+  return cache.emplace(std::pair{board, fill}, state).first->second;
+}
+
+void board_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"board", "fill"});
+  for (int board : BOARDS)
+    for (int fill : FILL_LEVELS)
+      b->Args({board, fill});
+}
+
+/** Report the allocations made since `scope` was constructed, per iteration. */
+void count_allocations(benchmark::State& bm_state, const alloc_counter::Scope& scope)
+{
+  bm_state.counters["allocs"] =
+      benchmark::Counter(scope.allocations(), benchmark::Counter::kAvgIterations);
+}
+
+const State& setup(benchmark::State& bm_state)
+{
+  const State& ret = board_at(bm_state.range(0), bm_state.range(1));
+  bm_state.counters["cells"] = ret.n_cells();
+  Rand::set_global_seed(SEED);
+  return ret;
+}
+
+void BM_StateCopy(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  for (auto _ : bm_state)
+  {
+    State copy(state);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_StateCopy)->Apply(board_args);
+
+void BM_GenerateClusters(benchmark::State& bm_state)
+{
+  const Grid& grid = setup(bm_state).grid();
+  for (auto _ : bm_state)
+  {
+    clusters::generate_clusters(grid);
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_GenerateClusters)->Apply(board_args);
+
+void BM_GetValidClustersDescriptors(benchmark::State& bm_state)
+{
+  const Grid& grid = setup(bm_state).grid();
+  ClusterDataVec descriptors{};
+  descriptors.reserve(MAX_CELLS / 2);
+  alloc_counter::Scope scope{};
+  for (auto _ : bm_state)
+  {
+    clusters::get_valid_clusters_descriptors(grid, descriptors);
+    benchmark::DoNotOptimize(descriptors.data());
+  }
+  count_allocations(bm_state, scope);
+}
+BENCHMARK(BM_GetValidClustersDescriptors)->Apply(board_args);
+
+/** The same, dispatched on the number of colors left to the bit plane kernels. */
+void BM_ValidActionsData(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  ClusterDataVec descriptors{};
+  descriptors.reserve(MAX_CELLS / 2);
+  alloc_counter::Scope scope{};
+  for (auto _ : bm_state)
+  {
+    state.valid_actions_data(descriptors);
+    benchmark::DoNotOptimize(descriptors.data());
+  }
+  count_allocations(bm_state, scope);
+}
+BENCHMARK(BM_ValidActionsData)->Apply(board_args);
+
+void BM_HasNontrivialCluster(benchmark::State& bm_state)
+{
+  const Grid& grid = setup(bm_state).grid();
+  for (auto _ : bm_state)
+    benchmark::DoNotOptimize(clusters::has_nontrivial_cluster(grid));
+}
+BENCHMARK(BM_HasNontrivialCluster)->Apply(board_args);
+
+void BM_ZobristGetKey(benchmark::State& bm_state)
+{
+  const Grid& grid = setup(bm_state).grid();
+  for (auto _ : bm_state)
+    benchmark::DoNotOptimize(sg::zobrist::get_key(grid));
+}
+BENCHMARK(BM_ZobristGetKey)->Apply(board_args);
+
+/** Applies each valid action in turn, on a fresh copy of the grid (copy included). */
+void BM_ApplyAction(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  const auto actions = state.valid_actions_data();
+  if (actions.empty())
+  {
+    bm_state.SkipWithError("No valid action on this board");
+    return;
+  }
+  size_t ndx = 0;
+  for (auto _ : bm_state)
+  {
+    Grid grid = state.grid();
+    benchmark::DoNotOptimize(clusters::apply_action(grid, actions[ndx].rep));
+    ndx = ndx + 1 < actions.size() ? ndx + 1 : 0;
+  }
+}
+BENCHMARK(BM_ApplyAction)->Apply(board_args);
+
+/** All the children of the state: the valid actions, then a copy applying each. */
+void BM_CopyAndApplyChildren(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  ClusterDataVec actions{};
+  std::vector<State> children{};
+  for (auto _ : bm_state)
+  {
+    state.valid_actions_data(actions);
+    children.assign(actions.size(), state);
+    for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+      children[ndx].apply_action(actions[ndx]);
+    benchmark::DoNotOptimize(children.data());
+  }
+}
+BENCHMARK(BM_CopyAndApplyChildren)->Apply(board_args);
+
+/** The same, built from the cells of the clusters found by a single labelling. */
+void BM_GenerateChildren(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  ClusterDataVec actions{};
+  std::vector<State> children{};
+  for (auto _ : bm_state)
+  {
+    state.generate_children(actions, children);
+    benchmark::DoNotOptimize(children.data());
+  }
+}
+BENCHMARK(BM_GenerateChildren)->Apply(board_args);
+
+/** On a fresh copy of the grid (copy included). */
+void BM_KillRandomCluster(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  for (auto _ : bm_state)
+  {
+    Grid grid = state.grid();
+    benchmark::DoNotOptimize(clusters::kill_random_cluster(grid));
+  }
+}
+BENCHMARK(BM_KillRandomCluster)->Apply(board_args);
+
+/** A random playout to the end of the game, from a copy of the state. */
+void BM_RandomPlayout(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  int64_t n_actions = 0;
+  alloc_counter::Scope scope{};
+  for (auto _ : bm_state)
+  {
+    State copy(state);
+    while (!copy.is_terminal())
+    {
+      copy.apply_random_action();
+      ++n_actions;
+    }
+    benchmark::DoNotOptimize(copy);
+  }
+  bm_state.counters["actions"] =
+      benchmark::Counter(n_actions, benchmark::Counter::kAvgIterations);
+  count_allocations(bm_state, scope);
+}
+BENCHMARK(BM_RandomPlayout)->Apply(board_args);
+
+/**
+ * A game to the end playing the valid action of the smallest rep, the actions
+ * generated after each move: on the grid, and on the region graph updated in place
+ * (its construction included).
+ */
+void BM_GameOfFirstActions(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  ClusterDataVec actions{};
+  actions.reserve(MAX_CELLS / 2);
+  for (auto _ : bm_state)
+  {
+    State copy(state);
+    for (copy.valid_actions_data(actions); !actions.empty(); copy.valid_actions_data(actions))
+      copy.apply_action(actions.front());
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_GameOfFirstActions)->Apply(board_args);
+
+void BM_RegionGraphGameOfFirstActions(benchmark::State& bm_state)
+{
+  const State& state = setup(bm_state);
+  ClusterDataVec actions{};
+  actions.reserve(MAX_CELLS / 2);
+  for (auto _ : bm_state)
+  {
+    RegionGraph graph(state.grid());
+    for (graph.valid_actions(actions); !actions.empty(); graph.valid_actions(actions))
+    {
+      const auto first = std::min_element(actions.begin(), actions.end(), [](auto a, auto b) {
+        return a.rep < b.rep;
+      });
+      graph.apply_action(graph.region_of(first->rep));
+    }
+    benchmark::DoNotOptimize(graph);
+  }
+}
+BENCHMARK(BM_RegionGraphGameOfFirstActions)->Apply(board_args);
+
+/** The board in the text format of data/input.txt. */
+std::string board_text(const State& state)
+{
+  std::string ret;
+  for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+    ret += std::to_string(to_integral(state.grid()[cell]) - 1)
+           + (cell % WIDTH == WIDTH - 1 ? '\n' : ' ');
+  return ret;
+}
+
+void BM_ParseTextBoard(benchmark::State& bm_state)
+{
+  const std::string text = board_text(setup(bm_state));
+  for (auto _ : bm_state)
+  {
+    std::istringstream iss{text};
+    State state;
+    corpus::read_text(iss, state);
+    benchmark::DoNotOptimize(state);
+  }
+}
+BENCHMARK(BM_ParseTextBoard)->Apply(board_args);
+
+void BM_UnpackBinaryBoard(benchmark::State& bm_state)
+{
+  uint8_t packed[corpus::BinaryHeader::BOARD_BYTES];
+  corpus::pack(setup(bm_state).grid(), packed);
+  for (auto _ : bm_state)
+  {
+    State state = corpus::unpack(packed);
+    benchmark::DoNotOptimize(state);
+  }
+}
+BENCHMARK(BM_UnpackBinaryBoard)->Apply(board_args);
+
+} // namespace
+
+BENCHMARK_MAIN();
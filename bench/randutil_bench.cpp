@@ -0,0 +1,92 @@
+/// randutil_bench.cpp
+///
+/// Compare Rand::Util with the engine it replaced (std::mt19937 behind a
+/// std::uniform_int_distribution built on every call) on the operations of the
+/// random playouts.
+///
+#include "rand.h"
+#include "grid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+namespace {
+
+/** The former Rand::Util. */
+template<typename Int_T>
+class Mt19937_Util
+{
+ public:
+  Mt19937_Util(uint32_t seed) : gen(seed) {}
+
+  Int_T get(Int_T _min, Int_T _max)
+  {
+    return std::uniform_int_distribution<Int_T>(_min, _max)(gen);
+  }
+
+  template<size_t N>
+  void shuffle(std::array<Int_T, N>& arr, Int_T sz)
+  {
+    for (auto i = 0; i < sz - 1; ++i)
+    {
+      auto j = get(i, sz - 1);
+      std::swap(arr[i], arr[j]);
+    }
+  }
+
+ private:
+  std::mt19937 gen;
+};
+
+template<typename Func>
+double ns_per_call(Func&& f, int n_calls)
+{
+  auto tik = std::chrono::steady_clock::now();
+  for (int i = 0; i < n_calls; ++i)
+    f();
+  auto tok = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(tok - tik).count() / n_calls;
+}
+
+// Keeps the compiler from optimizing the benchmarked calls away.
+volatile int sink = 0;
+
+template<typename Util>
+void run(const char* name, Util& util, int n_calls)
+{
+  std::array<int, sg::WIDTH> row{};
+  std::iota(row.begin(), row.end(), 0);
+
+  const double get = ns_per_call([&]() { sink = sink + util.get(0, sg::WIDTH - 1); },
+                                 n_calls);
+  const double shuffle = ns_per_call(
+      [&]() {
+        util.template shuffle<sg::WIDTH>(row, sg::WIDTH);
+        sink = sink + row[0];
+      },
+      n_calls / sg::WIDTH);
+
+  std::cout << std::left << std::setw(12) << name << std::fixed << std::setprecision(2)
+            << "get(0, " << sg::WIDTH - 1 << "): " << std::setw(8) << get << " ns"
+            << "  shuffle<" << sg::WIDTH << ">: " << shuffle << " ns\n";
+}
+
+} // namespace
+
+int main()
+{
+  constexpr int n_calls = 50'000'000;
+  constexpr uint32_t seed = 12345;
+
+  Mt19937_Util<int> mt_util(seed);
+  Rand::Util<int> xoshiro_util(seed);
+
+  run("mt19937", mt_util, n_calls);
+  run("xoshiro256", xoshiro_util, n_calls);
+
+  return 0;
+}
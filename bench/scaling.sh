@@ -0,0 +1,27 @@
+#!/bin/bash
+# Build bench/scaling_bench for boards of several sizes (the geometry is fixed at
+# compile time) and gather their results into one CSV table on stdout.
+#
+# Usage: bench/scaling.sh [SIZE...] [-- SCALING_BENCH_OPTIONS...]
+#   e.g. bench/scaling.sh 15 30 50 -- --boards 10 --time 500
+# The options of the configure step can be added with CMAKE_ARGS, e.g. to point
+# FetchContent at local copies of the dependencies.
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SIZES=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+  SIZES+=("$1")
+  shift
+done
+[ "$1" == "--" ] && shift
+[ ${#SIZES[@]} -eq 0 ] && SIZES=(15 20 30 40 50)
+
+HEADER=""
+for size in "${SIZES[@]}"; do
+  build="$ROOT/build-scaling-$size"
+  cmake -S "$ROOT" -B "$build" -DSG_BOARD_WIDTH="$size" -DSG_BOARD_HEIGHT="$size" $CMAKE_ARGS >&2
+  cmake --build "$build" --target scaling_bench -j"$(nproc)" >&2
+  "$build/scaling_bench" $HEADER "$@"
+  HEADER="--no-header"
+done
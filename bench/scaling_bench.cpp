@@ -0,0 +1,155 @@
+/// scaling_bench.cpp
+///
+/// How the engine scales with the area of the board, which is fixed at compile
+/// time: bench/scaling.sh builds this benchmark for several geometries and gathers
+/// the rows of the runs into one table.
+///
+/// On random boards of the compiled geometry (see board_gen.h), it measures the
+/// generation of the valid actions of the full boards, random playouts, and a
+/// search of the solvers' agent for --time milliseconds per board, with the memory
+/// it takes per node. One CSV row is written on stdout, after a header line unless
+/// --no-header.
+///
+/// Usage: scaling_bench [--boards N] [--colors K] [--clustering P] [--time MS]
+///                      [--seed S] [--no-header]
+///
+#include "agents.h"
+#include "board_gen.h"
+#include "rand.h"
+#include "samegame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace sg;
+
+struct Config
+{
+  int n_boards = 20;
+  gen::Params params{};
+  unsigned int time_ms = 1000;
+  uint64_t seed = 2021;
+  bool header = true;
+};
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--no-header")
+    {
+      config.header = false;
+      continue;
+    }
+    if (i + 1 >= argc)
+      return false;
+    const std::string value = argv[++i];
+    if (arg == "--boards")
+      config.n_boards = std::stoi(value);
+    else if (arg == "--colors")
+      config.params.n_colors = std::stoi(value);
+    else if (arg == "--clustering")
+      config.params.clustering = std::stod(value);
+    else if (arg == "--time")
+      config.time_ms = std::stoul(value);
+    else if (arg == "--seed")
+      config.seed = std::stoull(value);
+    else
+      return false;
+  }
+  return config.n_boards > 0 && gen::check(config.params).empty();
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Keeps the compiler from optimizing the benchmarked calls away.
+volatile size_t sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config))
+  {
+    std::cerr << "Usage: " << argv[0]
+              << " [--boards N] [--colors K] [--clustering P] [--time MS] [--seed S]"
+                 " [--no-header]\n";
+    return EXIT_FAILURE;
+  }
+  Rand::set_global_seed(config.seed);
+
+  std::vector<State> boards;
+  for (int i = 0; i < config.n_boards; ++i)
+    boards.push_back(gen::generate(config.params, config.seed, i));
+
+  // The valid actions of the full boards.
+  ClusterDataVec actions;
+  actions.reserve(MAX_ACTIONS);
+  size_t n_actions = 0;
+  int n_calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (seconds_since(start) < 0.5)
+  {
+    for (const State& board : boards)
+    {
+      board.valid_actions_data(actions);
+      n_actions += actions.size();
+      ++n_calls;
+    }
+  }
+  const double action_gen_us = seconds_since(start) * 1e6 / n_calls;
+  const double actions_per_board = double(n_actions) / n_calls;
+
+  // Uniformly random playouts from the full boards.
+  size_t n_playouts = 0, n_moves = 0;
+  start = std::chrono::steady_clock::now();
+  while (seconds_since(start) < 1.0)
+  {
+    for (const State& board : boards)
+    {
+      State state = board;
+      while (!state.is_trivial(state.apply_random_action()))
+        ++n_moves;
+      ++n_playouts;
+    }
+  }
+  const double playouts_per_sec = n_playouts / seconds_since(start);
+  sink = sink + n_moves;
+
+  // The search of the solvers.
+  double search_s = 0.0, bytes_per_node = 0.0, nodes = 0.0;
+  uint64_t iterations = 0;
+  for (const State& board : boards)
+  {
+    State state = board;
+    MctsAgent mcts(state);
+    configure(mcts, 1.0);
+    mcts.set_max_time(config.time_ms);
+    start = std::chrono::steady_clock::now();
+    mcts.run();
+    search_s += seconds_since(start);
+    iterations += mcts.get_iterations_cnt();
+    const auto memory = mcts.get_memory_usage();
+    nodes += memory.n_nodes;
+    bytes_per_node += double(memory.total_bytes()) / std::max<size_t>(memory.n_nodes, 1);
+  }
+
+  if (config.header)
+    std::cout << "width,height,cells,actions,action_gen_us,playouts_per_s,playout_len,"
+                 "iterations_per_s,nodes,bytes_per_node\n";
+  std::cout << WIDTH << ',' << HEIGHT << ',' << MAX_CELLS << ',' << actions_per_board << ','
+            << action_gen_us << ',' << playouts_per_sec << ','
+            << double(n_moves) / n_playouts << ',' << iterations / search_s << ','
+            << nodes / boards.size() << ',' << bytes_per_node / boards.size() << '\n';
+  return EXIT_SUCCESS;
+}
@@ -1,166 +1,387 @@
 // benchmark.cpp
+//
+// Run the search on the boards of the codingame dataset (data/test*.json), or of a
+// binary corpus with --corpus (the boards being numbered from 1), and report the
+// results in CSV or JSON.
+//
+// Each run happens in its own forked process, so that the runs are isolated
+// from each other and their peak memory can be measured. Up to `--jobs` of them
+// run at the same time.
+//
+// Usage: benchmark [--data DIR | --corpus FILE] [--boards FIRST-LAST] [--jobs N]
+//                  [--time MS] [--iterations N] [--seed S] [--format csv|json]
+//                  [--output FILE]
+//
 #include "samegame.h"
+#include "corpus.h"
 #include "mcts.h"
 #include "policies.h"
+#include "rand.h"
 
 #include <algorithm>
-#include <iomanip>
-#include <thread>
+#include <chrono>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
-#include <string>
+#include <map>
 #include <sstream>
+#include <string>
+#include <vector>
 
-#include "display.h"
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace sg;
 using namespace mcts;
 
-template<typename T>
-void OUT(const T& t)
+using policies::TimeCutoff_UCB_Func;
+
+using MctsAgent =
+    Mcts<sg::State,
+         sg::ClusterData,
+         TimeCutoff_UCB_Func<30>,
+         policies::Default_Playout_Func<sg::State, sg::ClusterData>,
+         128>;
+
+struct Config
 {
-  std::cout << t << std::endl;
-}
+  std::string data_dir = "../data";
+  /** A binary corpus to take the boards from instead, see corpus.h. */
+  std::string corpus = "";
+  int first_board = 1;
+  int last_board = 50;
+  int jobs = 1;
+  int max_time = 5000;
+  int max_iterations = 0;
+  double expl_cst = 1.0;
+  uint64_t seed = Rand::global_seed();
+  std::string format = "csv";
+  std::string output = "";
+};
 
-auto now() { return std::chrono::steady_clock::now(); }
+/**
+ * The outcome of one run. It is written as is by the worker into a pipe.
+ */
+struct RunResult
+{
+  int board;
+  uint64_t seed;
+  bool valid;
+  int score;
+  int n_actions;
+  unsigned int iterations;
+  size_t nodes;
+  size_t edges;
+  double seconds;
+  long peak_rss_kb;
+
+  double iterations_per_sec() const { return seconds > 0 ? iterations / seconds : 0.0; }
+};
 
-auto time(auto start, auto end)
+/** The seed of the run on the given board, derived from the corpus seed. */
+uint64_t run_seed(uint64_t seed, int board)
 {
-  std::chrono::duration<double> elapsed = end - start;
-  return elapsed.count();
+  uint64_t x = seed ^ (static_cast<uint64_t>(board) << 32);
+  return Rand::splitmix64(x);
 }
 
-template<int N>
-struct TimeCutoff_UCB_Func
+RunResult run_test(const Config& config, int board, const State& initial_state)
 {
-  auto operator()(double expl_cst, unsigned int n_parent_visits)
-  {
-    return [expl_cst, n_parent_visits]<typename EdgeT>(const EdgeT& edge) {
-      double ret =
-          (n_parent_visits < N
-               ? expl_cst * sqrt(log(n_parent_visits) / (edge.n_visits + 1.0))
-               : 0.000000001);
-      return ret + edge.avg_val;
-    };
-  }
-};
+  RunResult ret{};
+  ret.board = board;
+  ret.seed = run_seed(config.seed, board);
+  Rand::set_global_seed(ret.seed);
 
-std::pair<State, bool> input(const std::string& filename)
+  State state = initial_state;
+  MctsAgent mcts(state, TimeCutoff_UCB_Func<30>{});
+
+  mcts.set_exploration_constant(config.expl_cst);
+  mcts.set_max_iterations(config.max_iterations);
+  mcts.set_max_time(config.max_time);
+  mcts.set_backpropagation_strategy(
+      MctsAgent::BackpropagationStrategy::best_value);
+  mcts.set_expansion_strategy(MctsAgent::ExpansionStrategy::progressive);
+
+  auto tik = std::chrono::steady_clock::now();
+  std::vector<ClusterData> action_seq =
+      mcts.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
+  auto tok = std::chrono::steady_clock::now();
+
+  ret.seconds = std::chrono::duration<double>(tok - tik).count();
+  ret.score = score_sequence(initial_state, action_seq);
+  ret.valid = ret.score >= 0;
+  ret.n_actions = action_seq.size();
+  ret.iterations = mcts.get_iterations_cnt();
+  const auto memory = mcts.get_memory_usage();
+  ret.nodes = memory.n_nodes;
+  ret.edges = memory.n_edges;
+  return ret;
+}
+
+/**
+ * Run the boards in forked workers, at most `config.jobs` at a time.
+ *
+ * @Return The results, in the order of the boards. The peak memory of each run
+ * is the maximum resident set size of its worker.
+ */
+std::vector<RunResult> run_corpus(const Config& config,
+                                  const std::vector<std::pair<int, State>>& boards)
 {
-  std::ifstream _if(filename);
-  if (!_if)
-  {
-    std::cerr << "Could not open file!";
-    return std::pair{State(), false};
-  }
+  std::vector<RunResult> ret(boards.size());
+  std::map<pid_t, std::pair<size_t, int>> running; // pid -> (board index, read fd)
+  size_t next = 0;
+  size_t n_done = 0;
 
-  std::string buf;
-  size_t n = std::string::npos;
-  while (n == std::string::npos)
+  while (n_done < boards.size())
   {
-    std::getline(_if, buf);
-    n = buf.find("In");
-  }
+    while (next < boards.size() && static_cast<int>(running.size()) < config.jobs)
+    {
+      int fds[2];
+      if (pipe(fds) != 0)
+      {
+        std::perror("pipe");
+        std::exit(EXIT_FAILURE);
+      }
+      pid_t pid = fork();
+      if (pid < 0)
+      {
+        std::perror("fork");
+        std::exit(EXIT_FAILURE);
+      }
+      if (pid == 0)
+      {
+        close(fds[0]);
+        const auto& [board, state] = boards[next];
+        RunResult result = run_test(config, board, state);
+        bool written = write(fds[1], &result, sizeof(result)) == sizeof(result);
+        _exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+      }
+      close(fds[1]);
+      running.emplace(pid, std::pair{next, fds[0]});
+      ++next;
+    }
 
-  std::string cut = buf.substr(n + 6);
-  std::istringstream iss{cut};
+    int status = 0;
+    rusage usage{};
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid < 0)
+    {
+      std::perror("wait4");
+      std::exit(EXIT_FAILURE);
+    }
+    auto it = running.find(pid);
+    if (it == running.end())
+      continue;
 
-  Grid grid{};
-  ColorCounter ccolors{};
-  for (int i = 0; i < 15; ++i)
-  {
-    std::transform(std::istream_iterator<int>(iss),
-                   std::istream_iterator<int>(),
-                   grid.begin() + i * 15,
-                   [&ccolors](int i) { ++ccolors[i+1]; return sg::Color(i + 1); });
-    iss.clear();
-    iss.get();
-    iss.get();
+    auto [ndx, fd] = it->second;
+    RunResult& result = ret[ndx];
+    if (read(fd, &result, sizeof(result)) != sizeof(result))
+    {
+      result = RunResult{};
+      result.board = boards[ndx].first;
+      result.score = -1;
+      std::cerr << "The run on board " << result.board << " failed." << std::endl;
+    }
+    result.peak_rss_kb = usage.ru_maxrss;
+    close(fd);
+    running.erase(it);
+    ++n_done;
+
+    std::cerr << "[" << n_done << "/" << boards.size() << "] board " << result.board
+              << ": score " << result.score << ", " << result.iterations
+              << " iterations" << std::endl;
   }
-  auto ret = State(std::move(grid), std::move(ccolors));
-  return std::pair{ret, true};
+  return ret;
 }
 
-auto generate_fns(int i)
+RunResult totals(const std::vector<RunResult>& results)
 {
-  auto num = std::to_string(i);
-  return "../data/test" + num + ".json";
+  RunResult ret{};
+  ret.board = static_cast<int>(results.size());
+  ret.valid = true;
+  for (const auto& r : results)
+  {
+    ret.valid = ret.valid && r.valid;
+    ret.score += std::max(r.score, 0);
+    ret.n_actions += r.n_actions;
+    ret.iterations += r.iterations;
+    ret.nodes += r.nodes;
+    ret.edges += r.edges;
+    ret.seconds += r.seconds;
+    ret.peak_rss_kb = std::max(ret.peak_rss_kb, r.peak_rss_kb);
+  }
+  return ret;
 }
 
-bool run_test(std::ofstream& ofs,
-              int i,
-              int max_time,
-              double expl_cst)
+void write_csv(std::ostream& out,
+               const std::vector<RunResult>& results,
+               const RunResult& total)
 {
-  std::string filename = generate_fns(i + 1);
-
-  auto [state, file_opened] = input(filename);
+  out << "board,seed,valid,score,actions,iterations,nodes,edges,seconds,"
+         "iterations_per_sec,peak_rss_kb\n";
+  auto row = [&out](const std::string& board, const RunResult& r) {
+    out << board << ',' << r.seed << ',' << r.valid << ',' << r.score << ','
+        << r.n_actions << ',' << r.iterations << ',' << r.nodes << ',' << r.edges
+        << ',' << std::fixed << std::setprecision(3) << r.seconds << ','
+        << std::setprecision(1) << r.iterations_per_sec() << ',' << r.peak_rss_kb
+        << '\n';
+  };
+  for (const auto& r : results)
+    row(std::to_string(r.board), r);
+  row("total", total);
+}
 
-  const auto state_backup = state;
+void write_json(std::ostream& out,
+                const Config& config,
+                const std::vector<RunResult>& results,
+                const RunResult& total)
+{
+  auto fields = [&out](const RunResult& r) {
+    out << "\"valid\": " << (r.valid ? "true" : "false") << ", \"score\": " << r.score
+        << ", \"actions\": " << r.n_actions << ", \"iterations\": " << r.iterations
+        << ", \"nodes\": " << r.nodes << ", \"edges\": " << r.edges << std::fixed
+        << std::setprecision(3) << ", \"seconds\": " << r.seconds
+        << std::setprecision(1) << ", \"iterations_per_sec\": " << r.iterations_per_sec()
+        << ", \"peak_rss_kb\": " << r.peak_rss_kb;
+  };
 
-  if (!file_opened)
+  out << "{\n  \"config\": {\"jobs\": " << config.jobs
+      << ", \"max_time_ms\": " << config.max_time
+      << ", \"max_iterations\": " << config.max_iterations
+      << ", \"exploration_constant\": " << config.expl_cst
+      << ", \"seed\": " << config.seed << "},\n  \"runs\": [\n";
+  for (size_t i = 0; i < results.size(); ++i)
   {
-    return false;
+    out << "    {\"board\": " << results[i].board << ", \"seed\": " << results[i].seed
+        << ", ";
+    fields(results[i]);
+    out << (i + 1 < results.size() ? "},\n" : "}\n");
   }
+  out << "  ],\n  \"totals\": {\"boards\": " << total.board << ", ";
+  fields(total);
+  out << "}\n}\n";
+}
 
-  using MctsAgent =
-      Mcts<sg::State,
-           sg::ClusterData,
-           TimeCutoff_UCB_Func<30>,
-           policies::Default_Playout_Func<sg::State, sg::ClusterData>,
-           128>;
-  MctsAgent mcts(state, TimeCutoff_UCB_Func<30>{});
-
-  mcts.set_exploration_constant(expl_cst);
-  mcts.set_max_iterations(0);
-  mcts.set_max_time(max_time);
-  mcts.set_backpropagation_strategy(
-      MctsAgent::BackpropagationStrategy::best_value);
-
-  //auto tik = now();
-  std::vector<ClusterData> action_seq =
-      mcts.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
-  //auto tok = now();
-
-  ofs << "With max time of " << max_time / 1000.0 << "secs:\n";
-
-  ofs << "Number of iterations achieved for test " << i
-      << ": " << mcts.get_iterations_cnt()
-      << std::endl;
-
-  // std::cout << "Time taken for test " << i
-  //           << ": " << time(tik, tok) << " seconds."
-  //           << std::endl;
-  // Log the sequence found in the output file.
-  state_backup.log_action_sequence(ofs, action_seq);
+bool parse_args(int argc, char** argv, Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << arg << std::endl;
+      return false;
+    }
+    const std::string value = argv[++i];
 
+    if (arg == "--data")
+      config.data_dir = value;
+    else if (arg == "--corpus")
+      config.corpus = value;
+    else if (arg == "--boards")
+    {
+      auto dash = value.find('-');
+      config.first_board = std::stoi(value.substr(0, dash));
+      config.last_board =
+          dash == std::string::npos ? config.first_board : std::stoi(value.substr(dash + 1));
+    }
+    else if (arg == "--jobs")
+      config.jobs = std::max(1, std::stoi(value));
+    else if (arg == "--time")
+      config.max_time = std::stoi(value);
+    else if (arg == "--iterations")
+      config.max_iterations = std::stoi(value);
+    else if (arg == "--expl")
+      config.expl_cst = std::stod(value);
+    else if (arg == "--seed")
+      config.seed = std::stoull(value, nullptr, 0);
+    else if (arg == "--format" && (value == "csv" || value == "json"))
+      config.format = value;
+    else if (arg == "--output")
+      config.output = value;
+    else
+    {
+      std::cerr << "Unknown option " << arg << ' ' << value << std::endl;
+      return false;
+    }
+  }
   return true;
 }
 
-const int max_time = 60000;
-const int n_iterations = 10000;
-const double expl_cst = 1.0;
-
-int main()
+int main(int argc, char** argv)
 {
-  std::ofstream ofs("benchmark.log");
-  if (!ofs)
+  Config config{};
+  if (!parse_args(argc, argv, config))
   {
-    std::cerr << "Could not open output file!" << std::endl;
+    std::cerr << "Usage: " << argv[0]
+              << " [--data DIR | --corpus FILE] [--boards FIRST-LAST] [--jobs N]"
+                 " [--time MS] [--iterations N] [--expl C] [--seed S] [--format csv|json]"
+                 " [--output FILE]"
+              << std::endl;
     return EXIT_FAILURE;
   }
 
-  ofs << "Running with TimeCutoff_UCB_Func<30>, "
-      << max_time / 1000.0 << " seconds per test, "
-      << "exploration constant " << expl_cst
-      << std::endl;
+  std::vector<std::pair<int, State>> boards{};
+  if (!config.corpus.empty())
+  {
+    corpus::MappedCorpus mapped;
+    if (!mapped.open(config.corpus))
+    {
+      std::cerr << mapped.error() << std::endl;
+      return EXIT_FAILURE;
+    }
+    for (int i = config.first_board; i <= config.last_board; ++i)
+    {
+      if (i < 1 || static_cast<size_t>(i) > mapped.size())
+      {
+        std::cerr << "No board " << i << " in " << config.corpus << std::endl;
+        return EXIT_FAILURE;
+      }
+      boards.emplace_back(i, mapped[i - 1]);
+    }
+  }
+  else
+  {
+    for (int i = config.first_board; i <= config.last_board; ++i)
+    {
+      State state;
+      const std::string filename = corpus::test_path(config.data_dir, i);
+      if (!corpus::read_test(filename, state))
+      {
+        std::cerr << "Could not read the board in " << filename << std::endl;
+        return EXIT_FAILURE;
+      }
+      boards.emplace_back(i, state);
+    }
+  }
+
+  std::cerr << "Running " << boards.size() << " boards on " << config.jobs
+            << " workers, " << config.max_time / 1000.0 << " seconds per board, seed "
+            << config.seed << std::endl;
+
+  const auto results = run_corpus(config, boards);
+  auto total = totals(results);
+  total.seed = config.seed;
 
-  for (int i = 10; i < 21; ++i)
+  std::ofstream ofs{};
+  if (!config.output.empty())
   {
-    if (!run_test(ofs, i, max_time, 1.0))
+    ofs.open(config.output);
+    if (!ofs)
+    {
+      std::cerr << "Could not open output file!" << std::endl;
       return EXIT_FAILURE;
+    }
   }
+  std::ostream& out = config.output.empty() ? std::cout : ofs;
+
+  if (config.format == "json")
+    write_json(out, config, results, total);
+  else
+    write_csv(out, results, total);
 
-  return EXIT_SUCCESS;
+  return total.valid ? EXIT_SUCCESS : EXIT_FAILURE;
 }
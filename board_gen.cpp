@@ -0,0 +1,200 @@
+// board_gen.cpp
+//
+// Generate random boards, for the stress tests and the throughput and scaling
+// benchmarks (e.g. benchmark --corpus), to a binary corpus (see corpus.h) or as text
+// with --text.
+//
+// The filled part of the boards is --width x --height, in their bottom left corner.
+// The colors are 1 to --colors, drawn with the relative frequencies --weights
+// (uniform by default). With --clustering P, each cell copies the color of the
+// cell on its left or below with probability P, which makes larger clusters.
+//
+// Each board only depends on --seed and its index, so the output doesn't depend on
+// the number of --threads.
+//
+// Usage: board_gen [--count N] [--width W] [--height H] [--colors K]
+//                  [--weights W1,W2,...] [--clustering P] [--seed S] [--threads N]
+//                  [--text] --output FILE
+//
+#include "samegame.h"
+#include "board_gen.h"
+#include "corpus.h"
+#include "rand.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sg;
+
+namespace {
+
+struct Config
+{
+  uint64_t count = 10000;
+  gen::Params params{};
+  uint64_t seed = Rand::global_seed();
+  unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+  bool text = false;
+  std::string output = "";
+};
+
+void usage(const char* prog)
+{
+  std::cerr << "Usage: " << prog
+            << " [--count N] [--width W] [--height H] [--colors K] [--weights W1,W2,...]"
+               " [--clustering P] [--seed S] [--threads N] [--text] --output FILE\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--text")
+    {
+      config.text = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << arg << '\n';
+      return false;
+    }
+    const std::string value = argv[++i];
+
+    if (arg == "--count")
+      config.count = std::stoull(value);
+    else if (arg == "--width")
+      config.params.width = std::stoi(value);
+    else if (arg == "--height")
+      config.params.height = std::stoi(value);
+    else if (arg == "--colors")
+      config.params.n_colors = std::stoi(value);
+    else if (arg == "--weights")
+    {
+      config.params.weights.clear();
+      std::istringstream iss{value};
+      std::string weight;
+      while (std::getline(iss, weight, ','))
+        config.params.weights.push_back(std::stod(weight));
+    }
+    else if (arg == "--clustering")
+      config.params.clustering = std::stod(value);
+    else if (arg == "--seed")
+      config.seed = std::stoull(value);
+    else if (arg == "--threads")
+      config.threads = std::max(1ul, std::stoul(value));
+    else if (arg == "--output")
+      config.output = value;
+    else
+    {
+      std::cerr << "Invalid option " << arg << ' ' << value << '\n';
+      return false;
+    }
+  }
+  return !config.output.empty();
+}
+
+/** The boards are generated in parallel by batches, and written in order. */
+constexpr uint64_t BATCH_SIZE = 16384;
+
+/**
+ * Generate the boards [first, last): packed one after the other from `packed`, or
+ * as text into `text`.
+ */
+void generate_range(const Config& config, uint64_t first, uint64_t last, uint8_t* packed,
+                    std::string& text)
+{
+  std::ostringstream oss;
+  for (uint64_t ndx = first; ndx < last; ++ndx)
+  {
+    const State state = gen::generate(config.params, config.seed, ndx);
+    if (config.text)
+      corpus::write_text(oss, state);
+    else
+      corpus::pack(state.grid(),
+                   packed + (ndx - first) * corpus::BinaryHeader::BOARD_BYTES);
+  }
+  if (config.text)
+    text = std::move(oss).str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (const std::string error = gen::check(config.params); !error.empty())
+  {
+    std::cerr << error << '\n';
+    return EXIT_FAILURE;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  corpus::BinaryWriter writer;
+  std::ofstream text_out;
+  bool opened;
+  if (config.text)
+  {
+    text_out.open(config.output);
+    opened = static_cast<bool>(text_out);
+  }
+  else
+    opened = writer.open(config.output);
+  if (!opened)
+  {
+    std::cerr << "Could not create " << config.output << '\n';
+    return EXIT_FAILURE;
+  }
+
+  constexpr auto BOARD_BYTES = corpus::BinaryHeader::BOARD_BYTES;
+  std::vector<uint8_t> packed(config.text ? 0 : BATCH_SIZE * BOARD_BYTES);
+  std::vector<std::string> texts(config.threads);
+  std::vector<std::thread> workers;
+  for (uint64_t batch = 0; batch < config.count; batch += BATCH_SIZE)
+  {
+    const uint64_t batch_size = std::min(BATCH_SIZE, config.count - batch);
+    const uint64_t per_thread = (batch_size + config.threads - 1) / config.threads;
+    for (unsigned int t = 0; t < config.threads; ++t)
+    {
+      const uint64_t first = std::min(batch_size, t * per_thread);
+      const uint64_t last = std::min(batch_size, first + per_thread);
+      uint8_t* p_out = config.text ? nullptr : packed.data() + first * BOARD_BYTES;
+      workers.emplace_back(generate_range, std::cref(config), batch + first, batch + last,
+                           p_out, std::ref(texts[t]));
+    }
+    for (auto& worker : workers)
+      worker.join();
+    workers.clear();
+
+    if (config.text)
+    {
+      for (const auto& text : texts)
+        text_out << text;
+    }
+    else
+      writer.add_packed(packed.data(), batch_size);
+  }
+
+  if (config.text ? !text_out.flush() : !writer.close())
+  {
+    std::cerr << "Could not write " << config.output << '\n';
+    return EXIT_FAILURE;
+  }
+  std::cerr << config.count << " boards written to " << config.output << " in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+            << " seconds, seed " << config.seed << '\n';
+  return EXIT_SUCCESS;
+}
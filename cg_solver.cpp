@@ -0,0 +1,155 @@
+// cg_solver.cpp
+//
+// Play a game with the codingame protocol: each turn, read the board from stdin
+// (15 lines of 15 colors from the top row down, -1 for an empty cell) and write
+// the cell to play as "x y", (0, 0) being the bottom left cell.
+//
+// The process lives for the whole game and keeps its search tree between the
+// turns. The first turn gets a long time budget, the next ones a short one. The
+// latency and the reuse of the tree at each turn are logged on stderr.
+//
+// With --ponder, the search goes on in the background while waiting for the next
+// board, below the action just played.
+//
+// Usage: cg_solver [--first-turn MS] [--turn MS] [--margin MS] [--expl C] [--seed S]
+//                  [--ponder]
+//
+#include "samegame.h"
+#include "rand.h"
+#include "solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace sg;
+
+namespace {
+
+struct Config
+{
+  unsigned int first_turn_ms = 20000;
+  unsigned int turn_ms = 50;
+  /** Time kept for reading the board and writing the answer. */
+  unsigned int margin_ms = 5;
+  double expl_cst = 1.0;
+  uint64_t seed = Rand::global_seed();
+  bool ponder = false;
+};
+
+void usage(const char* prog)
+{
+  std::cerr << "Usage: " << prog
+            << " [--first-turn MS] [--turn MS] [--margin MS] [--expl C] [--seed S]"
+               " [--ponder]\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "--ponder"))
+    {
+      config.ponder = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << argv[i] << '\n';
+      return false;
+    }
+    const std::string value = argv[++i];
+    if (!std::strcmp(argv[i - 1], "--first-turn"))
+      config.first_turn_ms = std::stoul(value);
+    else if (!std::strcmp(argv[i - 1], "--turn"))
+      config.turn_ms = std::stoul(value);
+    else if (!std::strcmp(argv[i - 1], "--margin"))
+      config.margin_ms = std::stoul(value);
+    else if (!std::strcmp(argv[i - 1], "--expl"))
+      config.expl_cst = std::stod(value);
+    else if (!std::strcmp(argv[i - 1], "--seed"))
+      config.seed = std::stoull(value);
+    else
+    {
+      std::cerr << "Unknown option " << argv[i - 1] << '\n';
+      return false;
+    }
+  }
+  return true;
+}
+
+/** The codingame coordinates of the cell. */
+std::string to_coordinates(Cell cell)
+{
+  return std::to_string(cell % WIDTH) + ' ' + std::to_string(HEIGHT - 1 - cell / WIDTH);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  Rand::set_global_seed(config.seed);
+
+  Solver solver(Solver::Config{.expl_cst = config.expl_cst, .ponder = config.ponder});
+  int n_turns = 0;
+  double total_ms = 0.0;
+  double max_ms = 0.0;
+  double total_reuse = 0.0;
+
+  std::cerr << std::fixed << std::setprecision(1);
+  while (true)
+  {
+    State board(std::cin);
+    if (!std::cin)
+      break;
+    const auto start = std::chrono::steady_clock::now();
+
+    const unsigned int budget_ms = n_turns == 0 ? config.first_turn_ms : config.turn_ms;
+    const unsigned int search_ms = budget_ms > config.margin_ms ? budget_ms - config.margin_ms : 1;
+    ClusterData action = solver.play(board, search_ms);
+
+    // Whatever happens, answer with a valid cell.
+    if (board.is_trivial(action))
+    {
+      const auto actions = board.valid_actions_data();
+      action = actions.empty() ? ClusterData{.rep = CELL_BOTTOM_LEFT} : actions.front();
+    }
+    std::cout << to_coordinates(action.rep) << std::endl;
+    solver.ponder();
+
+    const double latency_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+    const auto& turn = solver.last_turn();
+    ++n_turns;
+    total_ms += latency_ms;
+    max_ms = std::max(max_ms, latency_ms);
+    total_reuse += turn.reuse_rate();
+
+    std::cerr << "Turn " << n_turns << ": " << latency_ms << " ms (budget " << budget_ms
+              << " ms), " << turn.iterations << " iterations";
+    if (config.ponder)
+      std::cerr << " (+" << turn.ponder_iterations << " pondering)";
+    std::cerr << ", " << turn.n_nodes << " nodes, tree "
+              << (turn.tree_reused ? "reused"
+                  : n_turns == 1   ? "new"
+                                   : "rebuilt (unexpected board)")
+              << ", "
+              << 100.0 * turn.reuse_rate() << "% of the root visits inherited\n";
+  }
+
+  if (n_turns > 0)
+    std::cerr << n_turns << " turns, latency " << total_ms / n_turns << " ms avg, "
+              << max_ms << " ms max, tree reuse " << 100.0 * total_reuse / n_turns
+              << "% avg\n";
+  return EXIT_SUCCESS;
+}
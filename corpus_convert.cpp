@@ -0,0 +1,152 @@
+// corpus_convert.cpp
+//
+// Convert boards to a binary corpus (see corpus.h), or a binary corpus back to text.
+//
+// The inputs are codingame test files (*.json), binary corpora (*.sgc) and text files
+// holding any number of boards in the format of data/input.txt, separated or not by
+// blank lines. The boards are written in the order of the inputs, to a binary corpus,
+// or as text with --text.
+//
+// Usage: corpus_convert [--text] --output FILE INPUT...
+//
+#include "samegame.h"
+#include "corpus.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace sg;
+
+namespace {
+
+struct Config
+{
+  std::string output = "";
+  bool text = false;
+  std::vector<std::string> inputs;
+};
+
+void usage(const char* prog)
+{
+  std::cerr << "Usage: " << prog << " [--text] --output FILE INPUT...\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "--text"))
+      config.text = true;
+    else if (!std::strcmp(argv[i], "--output") && i + 1 < argc)
+      config.output = argv[++i];
+    else if (!std::strncmp(argv[i], "--", 2))
+    {
+      std::cerr << "Invalid option " << argv[i] << '\n';
+      return false;
+    }
+    else
+      config.inputs.push_back(argv[i]);
+  }
+  return !config.output.empty() && !config.inputs.empty();
+}
+
+bool ends_with(const std::string& str, const std::string& suffix)
+{
+  return str.size() >= suffix.size()
+         && !str.compare(str.size() - suffix.size(), suffix.size(), suffix);
+}
+
+/** Pass each board of the file to `sink`. */
+template<typename Sink>
+bool read_boards(const std::string& filename, Sink&& sink)
+{
+  if (ends_with(filename, ".json"))
+  {
+    State state;
+    if (!corpus::read_test(filename, state))
+      return false;
+    sink(state);
+    return true;
+  }
+  if (ends_with(filename, ".sgc"))
+  {
+    corpus::MappedCorpus mapped;
+    if (!mapped.open(filename))
+    {
+      std::cerr << mapped.error() << '\n';
+      return false;
+    }
+    for (State state : mapped)
+      sink(state);
+    return true;
+  }
+
+  std::ifstream ifs(filename);
+  if (!ifs)
+    return false;
+  State state;
+  while (corpus::read_text(ifs, state))
+    sink(state);
+  // Anything left is an incomplete board.
+  return (ifs >> std::ws).eof();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  corpus::BinaryWriter writer;
+  std::ofstream text_out;
+  bool opened;
+  if (config.text)
+  {
+    text_out.open(config.output);
+    opened = static_cast<bool>(text_out);
+  }
+  else
+    opened = writer.open(config.output);
+  if (!opened)
+  {
+    std::cerr << "Could not create " << config.output << '\n';
+    return EXIT_FAILURE;
+  }
+
+  uint64_t n_boards = 0;
+  for (const auto& input : config.inputs)
+  {
+    const bool ok = read_boards(input, [&](const State& state) {
+      if (config.text)
+        corpus::write_text(text_out, state);
+      else
+        writer.add(state);
+      ++n_boards;
+    });
+    if (!ok)
+    {
+      std::cerr << "Could not read the boards of " << input << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (config.text ? !text_out.flush() : !writer.close())
+  {
+    std::cerr << "Could not write " << config.output << '\n';
+    return EXIT_FAILURE;
+  }
+  std::cerr << n_boards << " boards written to " << config.output << " in "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+            << " seconds\n";
+  return EXIT_SUCCESS;
+}
@@ -1,6 +1,9 @@
 #include "samegame.h"
+#include "agents.h"
+#include "clusterhelper.h"
 #include "mcts.h"
 #include "policies.h"
+#include "rand.h"
 
 #include <algorithm>
 #include <iomanip>
@@ -26,25 +29,7 @@ auto time(auto start, auto end)
   return elapsed.count();
 }
 
-/**
- * Remove the contribution from the log term after a given number of visits.
- *
- * NOTE This really improves the run-time and average score!
- */
-template<int N>
-struct TimeCutoff_UCB_Func
-{
-  auto operator()(double expl_cst, unsigned int n_parent_visits)
-  {
-    return [expl_cst, n_parent_visits]<typename EdgeT>(const EdgeT& edge) {
-      double ret =
-          (n_parent_visits < N
-               ? expl_cst * sqrt(log(n_parent_visits) / (edge.n_visits + 1.0))
-               : 0.00001);
-      return ret + edge.avg_val;
-    };
-  }
-};
+using policies::TimeCutoff_UCB_Func;
 
 /**
  * Weight the colors by the following rule:
@@ -80,45 +65,6 @@ struct ColorWeighted_UCB_Func
   const State& r_state;
 };
 
-/**
- * Applies a random action but tries to go for the color which has the least
- * number of cells in the grid first.
- */
-struct SmallColor_Playout_Func
-{
-  SmallColor_Playout_Func(State& _state)
-    : state(_state)
-  {
-  }
-
-  ClusterData operator()()
-  {
-    const ColorCounter& colors = state.color_counter();
-    const Color target = Color(std::distance(colors.begin(), std::min_element(colors.begin(), colors.end())));
-    return state.apply_random_action(target);
-  }
-
-  State& state;
-};
-
-// /**
-//  * Searches all the subtree when the number of valid actions is small enough
-//  */
-// struct Complete_Ends_Playout_Func
-// {
-//   Complete_Ends_Playout_Func(State& _state)
-//     : state(_state)
-//   {
-//   }
-
-//   ClusterData operator()()
-//   {
-//     auto actions = state.valid_actions_data();
-//   }
-
-//   State& state;
-// };
-
 
 /** Vizualize an action sequence in the console. */
 void vizualize(const State& state,
@@ -133,31 +79,20 @@ auto run_test(const State& state, int n_iterations, int max_time_in_ms, double e
   // Make a copy of the state to run the algorithm.
   State _state(state);
 
-  // Initialize the Mcts agent with our UCB function.
-  using MctsAgent = Mcts<sg::State,
-                         sg::ClusterData,
-                         //policies::Default_UCB_Func,
-                         //ColorWeighted_UCB_Func,
-                         TimeCutoff_UCB_Func<time_cst>,
-                         SmallColor_Playout_Func,
-                         128>;
-  //MctsAgent mcts(_state, ColorWeighted_UCB_Func(state));
-  //MctsAgent mcts(_state, policies::Default_UCB_Func{});
+  // The agent of the solvers (see agents.h), with the limits of the test.
   MctsAgent mcts(_state, TimeCutoff_UCB_Func<time_cst>{});
-
-  // Configure it.
-  mcts.set_exploration_constant(expl_cst);
+  configure(mcts, expl_cst);
   mcts.set_max_iterations(n_iterations);
   mcts.set_max_time(max_time_in_ms);
-  mcts.set_backpropagation_strategy(
-      MctsAgent::BackpropagationStrategy::best_value);
 
   // Get the resulting action sequence.
   std::vector<ClusterData> action_seq =
       mcts.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
   return std::make_tuple(action_seq,
                          mcts.get_iterations_cnt(),
-                         mcts.get_n_nodes() );
+                         mcts.get_n_nodes(),
+                         mcts.get_memory_usage(),
+                         mcts.get_stats() );
 }
 
 int n_iterations = 0;
@@ -179,6 +114,11 @@ int main()
   }
   // Read the initial data into the state.
   State state(_if);
+  if (!_if)
+  {
+    PRINT("Could not read the board of the input file");
+    return EXIT_FAILURE;
+  }
   _if.close();
 
   char t;
@@ -191,7 +131,9 @@ int main()
     auto tik = now();
     auto [action_seq,
           res_n_iterations,
-          res_n_nodes] = run_test(state, n_iterations, max_time_in_ms, expl_cst);
+          res_n_nodes,
+          res_memory,
+          res_stats] = run_test(state, n_iterations, max_time_in_ms, expl_cst);
     auto tok = now();
     auto time_taken = time(tik, tok);
 
@@ -203,10 +145,22 @@ int main()
           "\nMax number of iterations set: ", n_iterations,
           "\nNumber of iterations: ",         res_n_iterations,
           "\nNumber of nodes created ",       res_n_nodes,
+          "\nNumber of edges created ",       res_memory.n_edges,
+          "\nTree memory: ",                  res_memory.total_bytes() / 1024, " KiB (",
+          res_memory.bytes_per_node(), " bytes/node, ",
+          res_memory.bytes_per_edge(), " bytes/edge)",
           "\nTime taken: ",                   time_taken, " seconds",
           "\nExploration constant: ",         expl_cst,
+          "\nSeed: ",                         Rand::global_seed(),
           "\nTime cutoff constant: ",         time_cst);
 
+    if constexpr (instrument::enabled)
+    {
+      instrument::report_hw_status(std::cout << '\n');
+      std::cout << res_stats << clusters::kernel_stats() << std::endl;
+      clusters::kernel_stats() = clusters::KernelStats{};
+    }
+
     if (i < n_runs-1)
     {
       std::cin.ignore();
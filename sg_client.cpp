@@ -0,0 +1,117 @@
+// sg_client.cpp
+//
+// Send boards to sg_daemon and print its replies as they come, see sg_daemon.cpp
+// for the protocol. The boards are files in the format of data/input.txt, each one
+// is solved for `--time` milliseconds under the ID of its position on the command
+// line. With --stats, the statistics of the daemon are printed at the end.
+//
+// Usage: sg_client [--socket PATH] [--time MS] [--stats] [FILE...]
+//
+#include "unix_socket.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Config
+{
+  std::string socket = "/tmp/samegame.sock";
+  unsigned int time_ms = 1000;
+  bool stats = false;
+  std::vector<std::string> files;
+};
+
+void usage(const char* prog)
+{
+  std::cerr << "Usage: " << prog << " [--socket PATH] [--time MS] [--stats] [FILE...]\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (!std::strcmp(argv[i], "--stats"))
+      config.stats = true;
+    else if (!std::strcmp(argv[i], "--socket") || !std::strcmp(argv[i], "--time"))
+    {
+      if (i + 1 >= argc)
+      {
+        std::cerr << "Missing value for " << argv[i] << '\n';
+        return false;
+      }
+      if (!std::strcmp(argv[i], "--socket"))
+        config.socket = argv[++i];
+      else
+        config.time_ms = std::stoul(argv[++i]);
+    }
+    else if (!std::strncmp(argv[i], "--", 2))
+    {
+      std::cerr << "Unknown option " << argv[i] << '\n';
+      return false;
+    }
+    else
+      config.files.push_back(argv[i]);
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config) || (config.files.empty() && !config.stats))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const int fd = sg::net::connect_to(config.socket);
+  if (fd < 0)
+  {
+    std::cerr << "Could not connect to " << config.socket << ": " << std::strerror(errno)
+              << '\n';
+    return EXIT_FAILURE;
+  }
+
+  // Send all the boards at once, the daemon queues them.
+  size_t n_pending = 0;
+  for (size_t i = 0; i < config.files.size(); ++i)
+  {
+    std::ifstream file(config.files[i]);
+    if (!file)
+    {
+      std::cerr << "Could not open file " << config.files[i] << '\n';
+      continue;
+    }
+    std::ostringstream request;
+    request << "solve " << i << ' ' << config.time_ms << '\n' << file.rdbuf();
+    std::string data = request.str();
+    if (data.back() != '\n')
+      data += '\n';
+    if (!sg::net::send_all(fd, data))
+      break;
+    ++n_pending;
+  }
+
+  sg::net::LineReader reader(fd);
+  std::string line;
+  while (n_pending > 0 && reader.getline(line))
+  {
+    std::cout << line << std::endl;
+    if (!line.compare(0, 5, "done ") || !line.compare(0, 6, "error "))
+      --n_pending;
+  }
+
+  if (config.stats && sg::net::send_all(fd, "stats\n") && reader.getline(line))
+    std::cout << line << std::endl;
+
+  sg::net::send_all(fd, "quit\n");
+  ::close(fd);
+  return n_pending == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,292 @@
+// sg_daemon.cpp
+//
+// Solve boards for local clients over a Unix-domain socket, on a fixed pool of
+// workers which stay warm from one request to the next (see SolveService).
+//
+// The protocol is line based. The requests are:
+//
+//   solve ID MS       followed by the 15 lines of the board, in the format of
+//                     data/input.txt (-1 for an empty cell): search for MS
+//                     milliseconds. A malformed board gets an error, one short
+//                     of rows ends at the next request.
+//   stats             the state of the queue and the latencies of the requests.
+//   quit              close the connection.
+//
+// and the replies, the actions being written as "x,y" codingame coordinates ((0, 0)
+// is the bottom left cell):
+//
+//   queued ID DEPTH
+//   progress ID SEARCH_MS ITERATIONS SCORE ACTIONS...
+//   done ID SCORE ITERATIONS NODES QUEUE_MS SEARCH_MS ACTIONS...
+//   stats queue=N running=N completed=N p50=MS p90=MS p99=MS max=MS
+//   error MESSAGE
+//
+// The replies of different requests may interleave, they are told apart by their ID.
+//
+// Usage: sg_daemon [--socket PATH] [--workers N] [--progress MS] [--expl C] [--seed S]
+//
+#include "samegame.h"
+#include "corpus.h"
+#include "rand.h"
+#include "solve_service.h"
+#include "unix_socket.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace sg;
+
+namespace {
+
+struct Config
+{
+  std::string socket = "/tmp/samegame.sock";
+  unsigned int workers = std::max(std::thread::hardware_concurrency(), 1u);
+  unsigned int progress_ms = 100;
+  double expl_cst = 1.0;
+  uint64_t seed = Rand::global_seed();
+};
+
+void usage(const char* prog)
+{
+  std::cerr << "Usage: " << prog
+            << " [--socket PATH] [--workers N] [--progress MS] [--expl C] [--seed S]\n";
+}
+
+bool parse_args(int argc, char* argv[], Config& config)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value for " << argv[i] << '\n';
+      return false;
+    }
+    const std::string value = argv[++i];
+    if (!std::strcmp(argv[i - 1], "--socket"))
+      config.socket = value;
+    else if (!std::strcmp(argv[i - 1], "--workers"))
+      config.workers = std::stoul(value);
+    else if (!std::strcmp(argv[i - 1], "--progress"))
+      config.progress_ms = std::stoul(value);
+    else if (!std::strcmp(argv[i - 1], "--expl"))
+      config.expl_cst = std::stod(value);
+    else if (!std::strcmp(argv[i - 1], "--seed"))
+      config.seed = std::stoull(value);
+    else
+    {
+      std::cerr << "Unknown option " << argv[i - 1] << '\n';
+      return false;
+    }
+  }
+  return true;
+}
+
+volatile std::sig_atomic_t quit_requested = 0;
+
+void on_signal(int) { quit_requested = 1; }
+
+/**
+ * A client. The replies come from its own thread and from the workers, hence the
+ * lock. The socket is closed once the client left and its last request is done.
+ */
+class Connection
+{
+ public:
+  explicit Connection(int fd) : m_fd(fd) {}
+  ~Connection() { ::close(m_fd); }
+
+  int fd() const { return m_fd; }
+
+  void send(const std::string& line)
+  {
+    std::lock_guard lock(m_mutex);
+    net::send_all(m_fd, line);
+  }
+
+  /** Make the reading thread return, e.g. on shutdown. */
+  void shutdown() { ::shutdown(m_fd, SHUT_RD); }
+
+ private:
+  int m_fd;
+  std::mutex m_mutex;
+};
+
+std::string format_progress(const std::string& id, const SolveService::Progress& progress)
+{
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1);
+  if (progress.done)
+    oss << "done " << id << ' ' << progress.score << ' ' << progress.iterations << ' '
+        << progress.n_nodes << ' ' << progress.queue_ms << ' ' << progress.search_ms;
+  else
+    oss << "progress " << id << ' ' << progress.search_ms << ' ' << progress.iterations
+        << ' ' << progress.score;
+  corpus::write_coordinates(oss, progress.actions);
+  oss << '\n';
+  return oss.str();
+}
+
+std::string format_stats(const SolveService::Stats& stats)
+{
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1) << "stats queue=" << stats.queue_depth
+      << " running=" << stats.running << " completed=" << stats.completed
+      << " p50=" << stats.latency_p50_ms << " p90=" << stats.latency_p90_ms
+      << " p99=" << stats.latency_p99_ms << " max=" << stats.latency_max_ms << '\n';
+  return oss.str();
+}
+
+/** Read the requests of the client until it leaves. */
+void serve(std::shared_ptr<Connection> conn, SolveService& service)
+{
+  net::LineReader reader(conn->fd());
+  std::string line;
+  // A line which ended a board short of rows is the next request.
+  bool pending = false;
+  while (pending || reader.getline(line))
+  {
+    pending = false;
+    std::istringstream iss{line};
+    std::string command;
+    iss >> command;
+    if (command == "solve")
+    {
+      std::string id;
+      unsigned int max_time_ms = 0;
+      if (!(iss >> id >> max_time_ms))
+      {
+        conn->send("error expected: solve ID MS\n");
+        continue;
+      }
+      // A board short of rows stops at the next request, which is not eaten.
+      std::vector<std::string> rows;
+      while (rows.size() < HEIGHT && reader.getline(line))
+      {
+        if (!line.empty() && std::isalpha(static_cast<unsigned char>(line[0])))
+        {
+          pending = true;
+          break;
+        }
+        rows.push_back(line);
+      }
+      State board;
+      if (!parse_board(rows, board))
+      {
+        conn->send("error " + id + " invalid board: expected " + std::to_string(HEIGHT)
+                   + " rows of " + std::to_string(WIDTH) + " colors from -1 to "
+                   + std::to_string(MAX_COLORS - 1) + '\n');
+        continue;
+      }
+
+      const size_t depth = service.submit(
+          SolveService::Request{board, max_time_ms},
+          [conn, id](const SolveService::Progress& progress) {
+            conn->send(format_progress(id, progress));
+          });
+      conn->send("queued " + id + ' ' + std::to_string(depth) + '\n');
+    }
+    else if (command == "stats")
+      conn->send(format_stats(service.stats()));
+    else if (command == "quit")
+      break;
+    else if (!command.empty())
+      conn->send("error unknown command " + command + '\n');
+  }
+}
+
+struct Client
+{
+  std::shared_ptr<Connection> conn;
+  std::thread thread;
+  std::shared_ptr<std::atomic<bool>> finished;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Config config{};
+  if (!parse_args(argc, argv, config))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  Rand::set_global_seed(config.seed);
+
+  const int listen_fd = net::listen_at(config.socket);
+  if (listen_fd < 0)
+  {
+    std::cerr << "Could not listen at " << config.socket << ": " << std::strerror(errno)
+              << '\n';
+    return EXIT_FAILURE;
+  }
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+
+  SolveService service(SolveService::Config{.n_workers = config.workers,
+                                            .expl_cst = config.expl_cst,
+                                            .progress_ms = config.progress_ms});
+  std::cerr << "Listening at " << config.socket << " with " << config.workers
+            << " workers\n";
+
+  std::list<Client> clients;
+  while (!quit_requested)
+  {
+    pollfd pfd{.fd = listen_fd, .events = POLLIN, .revents = 0};
+    if (::poll(&pfd, 1, 200) > 0)
+    {
+      const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd >= 0)
+      {
+        auto conn = std::make_shared<Connection>(fd);
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        clients.push_back(Client{conn, std::thread([conn, finished, &service] {
+                                   serve(conn, service);
+                                   *finished = true;
+                                 }),
+                                 finished});
+      }
+    }
+
+    // Forget the clients gone.
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+      if (!*it->finished)
+      {
+        ++it;
+        continue;
+      }
+      it->thread.join();
+      it = clients.erase(it);
+    }
+  }
+
+  std::cerr << "Shutting down, " << format_stats(service.stats());
+  ::close(listen_fd);
+  ::unlink(config.socket.c_str());
+  for (auto& client : clients)
+  {
+    client.conn->shutdown();
+    client.thread.join();
+  }
+  // The requests already queued are still answered.
+  service.wait_idle();
+  return EXIT_SUCCESS;
+}
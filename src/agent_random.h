@@ -195,10 +195,10 @@ private:
     using time_point = std::chrono::time_point<std::chrono::steady_clock>;
 
     StateT& m_state;
-    std::array<ActionT, 128> best_variation;
+    std::vector<ActionT> best_variation;
     int best_variation_length;
     reward_type best_reward;
-    std::array<ActionT, 128> action_stack;
+    std::vector<ActionT> action_stack;
 
     unsigned int time_limit;
     unsigned int n_iterations;
@@ -260,21 +260,22 @@ private:
 
       simul_cnt = 0;
       avg_depth = 0;
-      unsigned int depth = 0;
-      action_stack[depth] = tmp_state.apply_random_action();
+      // The stack keeps its capacity from one simulation to the next.
+      action_stack.clear();
+      action_stack.push_back(tmp_state.apply_random_action());
 
-      while (!tmp_state.is_trivial(action_stack[depth]))
+      while (!tmp_state.is_trivial(action_stack.back()))
       {
-        score += tmp_state.evaluate(action_stack[depth]);
-        action_stack[++depth] = tmp_state.apply_random_action();
+        score += tmp_state.evaluate(action_stack.back());
+        action_stack.push_back(tmp_state.apply_random_action());
       }
       score += tmp_state.evaluate_terminal();
 
       if (score > best_reward)
       {
         best_reward = score;
-        best_variation = action_stack;
-        best_variation_length = depth;
+        best_variation.assign(action_stack.begin(), action_stack.end() - 1);
+        best_variation_length = best_variation.size();
       }
       ++simul_cnt;
     }
@@ -2,6 +2,7 @@
 #include "samegame.h"
 
 #include <iostream>
+#include <cstdlib>
 #include <fstream>
 
 
@@ -69,6 +70,8 @@ int main()
 {
     std::ifstream ifs("../data/input.txt");
     sg::State state(ifs);
+    if (!ifs)
+        return EXIT_FAILURE;
     mcts::Agent_random<sg::State, sg::ClusterData> agent(state);
 
     agent.set_time_limit(0);
@@ -0,0 +1,43 @@
+#ifndef __AGENTS_H_
+#define __AGENTS_H_
+
+#include "samegame.h"
+#include "mcts.h"
+#include "policies.h"
+
+namespace sg {
+
+/**
+ * The configuration of main.cpp: playouts aiming for the rarest color, with an
+ * exhaustive search of the endgames of at most 20 cells.
+ */
+using Endgame_Playout_Func =
+    policies::Hybrid_Playout_Func<State,
+                                  ClusterData,
+                                  20,
+                                  0,
+                                  16,
+                                  policies::SmallColor_Playout_Func<State, ClusterData>>;
+
+/** The agent of the long running solvers, see `configure`. */
+using MctsAgent = mcts::Mcts<State,
+                             ClusterData,
+                             policies::TimeCutoff_UCB_Func<20>,
+                             Endgame_Playout_Func,
+                             128>;
+
+/**
+ * Set the strategies of main.cpp. The limits are left to the caller, the
+ * iterations one being removed.
+ */
+inline void configure(MctsAgent& mcts, double expl_cst)
+{
+  mcts.set_exploration_constant(expl_cst);
+  mcts.set_max_iterations(0);
+  mcts.set_backpropagation_strategy(MctsAgent::BackpropagationStrategy::best_value);
+  mcts.set_expansion_strategy(MctsAgent::ExpansionStrategy::progressive);
+}
+
+} // namespace sg
+
+#endif
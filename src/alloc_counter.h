@@ -0,0 +1,56 @@
+#ifndef __ALLOC_COUNTER_H_
+#define __ALLOC_COUNTER_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Count the heap allocations of each thread by replacing the global operator new.
+ *
+ * @Note This defines the replacement functions, so include it in exactly one
+ * translation unit of an executable (a test or a benchmark), never in the library.
+ */
+namespace alloc_counter {
+
+/** Number of calls of operator new (all its forms) by the calling thread. */
+inline thread_local uint64_t n_allocations = 0;
+
+/**
+ * Number of allocations made by the calling thread since the construction.
+ */
+class Scope
+{
+ public:
+  uint64_t allocations() const { return n_allocations - m_start; }
+
+ private:
+  uint64_t m_start = n_allocations;
+};
+
+} // namespace alloc_counter
+
+void* operator new(std::size_t size)
+{
+  ++alloc_counter::n_allocations;
+  if (void* ret = std::malloc(size ? size : 1))
+    return ret;
+  throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+  ++alloc_counter::n_allocations;
+  // aligned_alloc wants a size multiple of the alignment.
+  const auto alignment = static_cast<std::size_t>(align);
+  if (void* ret = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+    return ret;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#endif
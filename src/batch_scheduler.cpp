@@ -0,0 +1,69 @@
+#include "batch_scheduler.h"
+
+#include <cmath>
+#include <limits>
+
+namespace sg {
+
+BatchScheduler::BatchScheduler(size_t n_boards, const Config& config)
+  : m_config(config), m_arms(n_boards), m_n_active(n_boards), m_last(n_boards - 1)
+{
+}
+
+size_t BatchScheduler::next() const
+{
+  const size_t n_boards = m_arms.size();
+  if (m_config.strategy == Strategy::round_robin)
+  {
+    for (size_t i = 1; i <= n_boards; ++i)
+    {
+      const size_t board = (m_last + i) % n_boards;
+      if (!m_arms[board].retired)
+        return board;
+    }
+    return n_boards;
+  }
+
+  size_t ret = n_boards;
+  double best = std::numeric_limits<double>::lowest();
+  const double log_total = std::log(std::max(m_total, 1.0));
+  for (size_t board = 0; board < n_boards; ++board)
+  {
+    const Arm& arm = m_arms[board];
+    if (arm.retired)
+      continue;
+    if (arm.n == 0.0)
+      return board;
+    const double ucb = arm.sum / arm.n + m_config.expl_cst * std::sqrt(log_total / arm.n);
+    if (ucb > best)
+    {
+      best = ucb;
+      ret = board;
+    }
+  }
+  return ret;
+}
+
+void BatchScheduler::update(size_t board, double reward)
+{
+  m_last = board;
+  m_total = m_total * m_config.discount + 1.0;
+  for (auto& arm : m_arms)
+  {
+    arm.n *= m_config.discount;
+    arm.sum *= m_config.discount;
+  }
+  m_arms[board].n += 1.0;
+  m_arms[board].sum += reward;
+}
+
+void BatchScheduler::retire(size_t board)
+{
+  if (!m_arms[board].retired)
+  {
+    m_arms[board].retired = true;
+    --m_n_active;
+  }
+}
+
+} // namespace sg
@@ -0,0 +1,79 @@
+#ifndef __BATCH_SCHEDULER_H_
+#define __BATCH_SCHEDULER_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace sg {
+
+/**
+ * Decide which board of a batch gets the next time slice, from the improvements of
+ * the previous slices: a discounted UCB bandit over the boards.
+ *
+ * The reward of a slice is what it added to the board's best score (the goal being
+ * the total score of the batch), in thousands of points. The old rewards fade with a
+ * factor `discount` per slice of the whole batch, so that the boards whose search has
+ * converged soon give their time to those still improving, while the exploration term
+ * makes sure every board is tried again from time to time.
+ *
+ * @Note See Garivier and Moulines, "On Upper-Confidence Bound Policies for
+ * Non-Stationary Bandit Problems".
+ */
+class BatchScheduler
+{
+ public:
+  enum class Strategy
+  {
+    /** The discounted UCB bandit. */
+    bandit,
+    /** Each board in turn, i.e. the same time for each board. */
+    round_robin
+  };
+
+  struct Config
+  {
+    Strategy strategy = Strategy::bandit;
+    double expl_cst = 0.1;
+    double discount = 0.95;
+  };
+
+  explicit BatchScheduler(size_t n_boards) : BatchScheduler(n_boards, Config{}) {}
+  BatchScheduler(size_t n_boards, const Config&);
+
+  /**
+   * The board which should get the next slice, the boards which were never tried
+   * coming first.
+   *
+   * @Return `n_boards` once every board is retired.
+   */
+  size_t next() const;
+
+  /** Record the reward of a slice given to the board. */
+  void update(size_t board, double reward);
+
+  /** Never give a slice to the board again, e.g. once it is solved. */
+  void retire(size_t board);
+
+  size_t n_active() const { return m_n_active; }
+
+ private:
+  struct Arm
+  {
+    /** The discounted number of slices and sum of the rewards. */
+    double n = 0.0;
+    double sum = 0.0;
+    bool retired = false;
+  };
+
+  Config m_config;
+  std::vector<Arm> m_arms;
+  size_t m_n_active;
+  /** The discounted number of slices of the whole batch. */
+  double m_total = 0.0;
+  /** The last board of the round robin. */
+  size_t m_last = 0;
+};
+
+} // namespace sg
+
+#endif
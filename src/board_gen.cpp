@@ -0,0 +1,100 @@
+#include "board_gen.h"
+#include "rand.h"
+
+#include <array>
+#include <numeric>
+#include <utility>
+
+namespace sg::gen {
+
+namespace {
+
+/** A uniform double in [0, 1), from the 53 high bits. */
+double uniform(Rand::Xoshiro256& gen)
+{
+  return (gen() >> 11) * 0x1.0p-53;
+}
+
+} // namespace
+
+std::string check(const Params& params)
+{
+  if (params.width < 1 || params.width > WIDTH || params.height < 1
+      || params.height > HEIGHT)
+    return "The size must be from 1x1 to " + std::to_string(WIDTH) + "x"
+           + std::to_string(HEIGHT);
+  if (params.n_colors < 1 || params.n_colors > MAX_COLORS)
+    return "The number of colors must be from 1 to " + std::to_string(MAX_COLORS);
+  if (!params.weights.empty())
+  {
+    if (params.weights.size() != static_cast<size_t>(params.n_colors))
+      return "Expected one weight per color";
+    for (const double weight : params.weights)
+    {
+      if (!(weight >= 0.0))
+        return "The weights can't be negative";
+    }
+    if (!(std::accumulate(params.weights.begin(), params.weights.end(), 0.0) > 0.0))
+      return "Some weight must be positive";
+  }
+  if (!(params.clustering >= 0.0 && params.clustering <= 1.0))
+    return "The clustering must be from 0 to 1";
+  return "";
+}
+
+State generate(const Params& params, uint64_t seed, uint64_t ndx)
+{
+  // Whiten both, so that close seeds and close indices give unrelated boards.
+  uint64_t x = seed;
+  x = Rand::splitmix64(x) ^ ndx;
+  Rand::Xoshiro256 gen(Rand::splitmix64(x));
+
+  // The cumulated weights, scaled to the draws of `uniform`.
+  std::array<double, MAX_COLORS> cumulated{};
+  const bool uniform_colors = params.weights.empty();
+  if (!uniform_colors)
+  {
+    std::partial_sum(params.weights.begin(), params.weights.end(), cumulated.begin());
+    for (int i = 0; i < params.n_colors; ++i)
+      cumulated[i] /= cumulated[params.n_colors - 1];
+  }
+  auto draw_color = [&]() {
+    if (uniform_colors)
+      return static_cast<int>(Rand::bounded(gen, params.n_colors)) + 1;
+    const double u = uniform(gen);
+    int color = 0;
+    while (color < params.n_colors - 1 && u >= cumulated[color])
+      ++color;
+    return color + 1;
+  };
+
+  Grid grid{};
+  ColorCounter ccolors{};
+  // From the bottom row up and from left to right, so that the neighbours on the
+  // left and below are already drawn.
+  for (int row = HEIGHT - 1; row >= HEIGHT - params.height; --row)
+  {
+    for (int col = 0; col < params.width; ++col)
+    {
+      const Cell cell = row * WIDTH + col;
+      std::array<Color, 2> neighbours;
+      int n_neighbours = 0;
+      if (col > 0)
+        neighbours[n_neighbours++] = grid[cell - 1];
+      if (row < HEIGHT - 1)
+        neighbours[n_neighbours++] = grid[cell + WIDTH];
+
+      Color color;
+      if (n_neighbours > 0 && params.clustering > 0.0 && uniform(gen) < params.clustering)
+        color = neighbours[n_neighbours == 1 ? 0 : Rand::bounded(gen, 2)];
+      else
+        color = to_enum<Color>(draw_color());
+      grid[cell] = color;
+      ++ccolors[to_integral(color)];
+    }
+  }
+  grid.n_empty_rows = HEIGHT - params.height;
+  return State(std::move(grid), std::move(ccolors));
+}
+
+} // namespace sg::gen
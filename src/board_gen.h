@@ -0,0 +1,50 @@
+#ifndef __BOARD_GEN_H_
+#define __BOARD_GEN_H_
+
+#include "samegame.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Random boards, for the stress tests and the throughput benchmarks which need many
+ * more boards than the codingame dataset.
+ */
+namespace sg::gen {
+
+struct Params
+{
+  /**
+   * The size of the filled part of the board, in its bottom left corner as if the
+   * rest had been played already. At most the compiled WIDTH x HEIGHT.
+   */
+  int width = WIDTH;
+  int height = HEIGHT;
+  /** The colors drawn are 1 to `n_colors`. */
+  int n_colors = MAX_COLORS;
+  /** The relative frequencies of the colors, `n_colors` of them. Empty for uniform. */
+  std::vector<double> weights;
+  /**
+   * The probability to copy the color of a neighbour already drawn (the cell on
+   * the left or the one below) instead of drawing a new one: 0 gives independent
+   * cells, close to 1 gives large clusters.
+   */
+  double clustering = 0.0;
+};
+
+/**
+ * @Return An empty string if boards can be generated with these parameters,
+ * otherwise what is wrong with them.
+ */
+std::string check(const Params&);
+
+/**
+ * The `ndx`th board generated from `seed`. A board only depends on its seed and
+ * its index, so that the boards may be generated in any order, in parallel.
+ */
+State generate(const Params&, uint64_t seed, uint64_t ndx);
+
+} // namespace sg::gen
+
+#endif
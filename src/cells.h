@@ -0,0 +1,84 @@
+// cells.h
+#ifndef __CELLS_H_
+#define __CELLS_H_
+
+#include "types.h"
+#include <array>
+#include <cstdint>
+
+/**
+ * Lookup tables of the geometry of the grid, computed at compile time so that the
+ * kernels neither divide by WIDTH nor test the edges of the grid.
+ */
+namespace sg::cells {
+
+/** The directions, as the bits of the NEIGHBOUR_MASK entries. */
+enum Direction : uint8_t
+{
+  RIGHT = 1,
+  DOWN = 2,
+  LEFT = 4,
+  UP = 8
+};
+
+/** The neighbours of a cell, in the order right, down, left, up. */
+struct Neighbours
+{
+  std::array<PackedCell, 4> cells{};
+  uint8_t n{0};
+
+  const PackedCell* begin() const { return cells.data(); }
+  const PackedCell* end() const { return cells.data() + n; }
+};
+
+inline constexpr std::array<uint16_t, MAX_CELLS> ROW = []() {
+  std::array<uint16_t, MAX_CELLS> ret{};
+  for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+    ret[cell] = cell / WIDTH;
+  return ret;
+}();
+
+inline constexpr std::array<uint16_t, MAX_CELLS> COL = []() {
+  std::array<uint16_t, MAX_CELLS> ret{};
+  for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+    ret[cell] = cell % WIDTH;
+  return ret;
+}();
+
+/** The directions in which each cell has a neighbour. */
+inline constexpr std::array<uint8_t, MAX_CELLS> NEIGHBOUR_MASK = []() {
+  std::array<uint8_t, MAX_CELLS> ret{};
+  for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+  {
+    ret[cell] = (COL[cell] < WIDTH - 1 ? RIGHT : 0) | (ROW[cell] < HEIGHT - 1 ? DOWN : 0)
+                | (COL[cell] > 0 ? LEFT : 0) | (ROW[cell] > 0 ? UP : 0);
+  }
+  return ret;
+}();
+
+inline constexpr std::array<Neighbours, MAX_CELLS> NEIGHBOURS = []() {
+  std::array<Neighbours, MAX_CELLS> ret{};
+  for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+  {
+    Neighbours& nbhs = ret[cell];
+    const uint8_t mask = NEIGHBOUR_MASK[cell];
+    if (mask & RIGHT)
+      nbhs.cells[nbhs.n++] = cell + 1;
+    if (mask & DOWN)
+      nbhs.cells[nbhs.n++] = cell + WIDTH;
+    if (mask & LEFT)
+      nbhs.cells[nbhs.n++] = cell - 1;
+    if (mask & UP)
+      nbhs.cells[nbhs.n++] = cell - WIDTH;
+  }
+  return ret;
+}();
+
+inline constexpr bool has_neighbour(Cell cell, Direction direction)
+{
+  return NEIGHBOUR_MASK[cell] & direction;
+}
+
+} // namespace sg::cells
+
+#endif
@@ -1,96 +1,95 @@
 #include "clusterhelper.h"
+#include "cells.h"
 #include "dsu.h"
 #include "rand.h"
 #include "types.h"
+#include <bit>
 #include <deque>
 #include <iostream>
 #include <set>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace sg::clusters {
 
 namespace {
 
 /**
- * Data structure to partition the grid into clusters by colors
+ * Data structure to partition the grid into clusters by colors. Each thread has
+ * its own, and it never allocates.
  */
-DSU<sg::Cluster, sg::MAX_CELLS> grid_dsu{};
+thread_local FlatDSU<Cell, sg::MAX_CELLS> grid_dsu{};
 
 /**
  * Utility class initializing a random number generator and implementing
- * the methods we need for the random actions.
+ * the methods we need for the random actions. Each thread has its own stream,
+ * derived from the global seed.
  */
-Rand::Util<Cell> rand_util{};
+Rand::Util<Cell>& rand_util()
+{
+  return Rand::thread_util<Cell, Rand::Domain::clusters>();
+}
+
+} // namespace
+
+KernelStats& kernel_stats()
+{
+  thread_local KernelStats stats{};
+  return stats;
+}
 
 //************************************** Grid manipulations **********************************/
 
-///TODO Remove the 'empty cel ls' stuff, or do something with it
 /**
  * Populate the disjoint data structure grid_dsu with all adjacent clusters
  * of cells sharing a same color.
+ *
+ * @Note This also records the number of empty rows of the grid in passing.
  */
 void generate_clusters(const Grid& _grid)
 {
+  instrument::ScopedTimer timer(kernel_stats().generate_clusters);
   grid_dsu.reset();
 
-  auto n_empty_rows = _grid.n_empty_rows;
-  bool row_empty = true;
-  bool found_empty_cell = false;
-  Cell empty_cell = CELL_NONE;
-
-  auto row = HEIGHT - 1;
   // Iterate from bottom row upwards so we can stop at the first empty row.
-  while (row > n_empty_rows)
+  for (auto row = HEIGHT - 1; row >= 0; --row)
   {
-    row_empty = true;
-    // Iterate through all columns except last
-    for (auto cell = row * WIDTH; cell < (row + 1) * WIDTH - 1; ++cell)
+    bool row_empty = true;
+
+    for (auto cell = row * WIDTH; cell < (row + 1) * WIDTH; ++cell)
     {
       if (_grid[cell] == Color::Empty)
         continue;
+      row_empty = false;
 
       // compare up
-      if (_grid[cell] == _grid[cell - WIDTH])
+      if (row > 0 && _grid[cell] == _grid[cell - WIDTH])
         grid_dsu.unite(cell, cell - WIDTH);
 
       // compare right
-      if (_grid[cell] == _grid[cell + 1])
+      if (cells::has_neighbour(cell, cells::RIGHT) && _grid[cell] == _grid[cell + 1])
         grid_dsu.unite(cell, cell + 1);
     }
-    Cell _cell = (row + 1) * WIDTH - 1;
-    // Last column
-    // If the row was empty, we are done.
-    if (row_empty = row_empty && _grid[_cell] == Color::Empty)
+    // If the row was empty, so are all the rows above it.
+    if (row_empty)
     {
-      _grid.n_empty_rows = row;
+      _grid.n_empty_rows = row + 1;
       return;
     }
-    // Compare up
-    if (_grid[_cell] == _grid[_cell - WIDTH])
-    {
-      grid_dsu.unite(_cell, _cell - WIDTH);
-    }
-    --row;
-  }
-
-  row_empty = true;
-  // The upmost non-empty row: only compare right
-  for (auto cell = 0; cell < CELL_UPPER_RIGHT - 1; ++cell)
-  {
-    if (_grid[cell] == Color::Empty)
-      continue;
-
-    if (_grid[cell] == _grid[cell + 1])
-      grid_dsu.unite(cell, cell + 1);
   }
-  if (row_empty = row_empty && _grid[CELL_UPPER_RIGHT] == Color::Empty)
-    ++_grid.n_empty_rows;
+  _grid.n_empty_rows = 0;
 }
 
+namespace {
+
 /**
  * Make cells drop down if they lie above empty cells.
  */
 void pull_cells_down(Grid& _grid)
 {
+  instrument::ScopedTimer timer(kernel_stats().pull_cells_down);
   // For all columns
   for (int i = 0; i < WIDTH; ++i)
   {
@@ -119,50 +118,36 @@ void pull_cells_down(Grid& _grid)
  */
 void pull_cells_left(Grid& _grid)
 {
-  int i = 0;
-  std::deque<int> zero_col;
+  instrument::ScopedTimer timer(kernel_stats().pull_cells_left);
+  // The cells are pulled down, so a column is empty iff its bottom cell is.
+  int n_nonempty = 0;
 
-  while (i < WIDTH)
+  for (int i = 0; i < WIDTH; ++i)
   {
-    if (zero_col.empty())
-    {
-      // Look for empty column
-      while (i < WIDTH - 1 && _grid[i + (HEIGHT - 1) * WIDTH] != Color::Empty)
-        ++i;
-      zero_col.push_back(i);
-      ++i;
-    }
-    else
+    if (_grid[i + (HEIGHT - 1) * WIDTH] == Color::Empty)
+      continue;
+    // Swap the non-empty column with the first empty one
+    if (i != n_nonempty)
     {
-      int x = zero_col.front();
-      zero_col.pop_front();
-      // Look for non-empty column
-      while (i < WIDTH && _grid[i + (HEIGHT - 1) * WIDTH] == Color::Empty)
-      {
-        zero_col.push_back(i);
-        ++i;
-      }
-      if (i == WIDTH)
-        break;
-      // Swap the non-empty column with the first empty one
       for (int j = 0; j < HEIGHT; ++j)
-        std::swap(_grid[x + j * WIDTH], _grid[i + j * WIDTH]);
-      zero_col.push_back(i);
-      ++i;
+        std::swap(_grid[n_nonempty + j * WIDTH], _grid[i + j * WIDTH]);
     }
+    ++n_nonempty;
   }
 }
 
 /**
  * Empty the cells of the cluster to which the given cell belongs, if
- * that cluster is valid.
+ * that cluster is valid. The leftmost column of the cluster goes to
+ * `col_min`.
  *
- * @Return The cluster descriptor of the given cell.
+ * @Return The cluster descriptor of the given cell, whose rep is the
+ * smallest cell of the cluster.
  */
-ClusterData kill_cluster(Grid& _grid, const Cell _cell)
+ClusterData kill_cluster(Grid& _grid, const Cell _cell, int& col_min)
 {
   const Color color = _grid[_cell];
-  ClusterData cd{_cell, color, 0};
+  ClusterData cd{static_cast<PackedCell>(_cell), color, 0};
 
   if (_cell == CELL_NONE || color == Color::Empty)
     return cd;
@@ -174,43 +159,24 @@ ClusterData kill_cluster(Grid& _grid, const Cell _cell)
 
   _grid[_cell] = Color::Empty;
   ++cd.size;
+  col_min = cells::COL[_cell];
 
   while (!ndx_back == 0)
   {
     cur = queue[--ndx_back];
 
     // We remove the cells adjacent to `cur` with the target color
-    // Look right
-    if (cur % WIDTH < WIDTH - 1 && _grid[cur + 1] == color)
+    for (const Cell nbh : cells::NEIGHBOURS[cur])
     {
-      queue[ndx_back] = cur + 1;
-      ++ndx_back;
-      _grid[cur + 1] = Color::Empty;
-      ++cd.size;
-    }
-    // Look down
-    if (cur < (HEIGHT - 1) * WIDTH && _grid[cur + WIDTH] == color)
-    {
-      queue[ndx_back] = cur + WIDTH;
-      ++ndx_back;
-      _grid[cur + WIDTH] = Color::Empty;
-      ++cd.size;
-    }
-    // Look left
-    if (cur % WIDTH > 0 && _grid[cur - 1] == color)
-    {
-      queue[ndx_back] = cur-1;
-      ++ndx_back;
-      _grid[cur - 1] = Color::Empty;
-      ++cd.size;
-    }
-    // Look up
-    if (cur > WIDTH - 1 && _grid[cur - WIDTH] == color)
-    {
-      queue[ndx_back] = cur - WIDTH;
-      ++ndx_back;
-      _grid[cur - WIDTH] = Color::Empty;
-      ++cd.size;
+      if (_grid[nbh] == color)
+      {
+        queue[ndx_back] = nbh;
+        ++ndx_back;
+        _grid[nbh] = Color::Empty;
+        ++cd.size;
+        cd.rep = std::min<PackedCell>(cd.rep, nbh);
+        col_min = std::min<int>(col_min, cells::COL[nbh]);
+      }
     }
   }
   // If only the rep was killed (cluster of size 1), restore it
@@ -220,18 +186,28 @@ ClusterData kill_cluster(Grid& _grid, const Cell _cell)
   return cd;
 }
 
+ClusterData kill_cluster(Grid& _grid, const Cell _cell)
+{
+  int col_min;
+  return kill_cluster(_grid, _cell, col_min);
+}
+
+} // namespace
+
 /// NOTE This is by far the hot spot in execution! (92% is spent here
 /**
  * Kill a random cluster
  *
  * @Return The cluster that was killed, or some cluster of size 0 or 1.
  */
-ClusterData kill_random_cluster(Grid& _grid, const Color target_color = Color::Empty)
+ClusterData kill_random_cluster(Grid& _grid, const Color target_color)
 {
+  instrument::ScopedTimer timer(kernel_stats().kill_random_cluster);
   using CellnColor = std::pair<Cell, Color>;
   ClusterData ret{};
 
   // Random numbers from n_empty_rows to HEIGHT at the beginning of the array
+  auto& rand_util = clusters::rand_util();
   std::array<int, HEIGHT> rows = rand_util.gen_ordering<HEIGHT>(_grid.n_empty_rows, HEIGHT);
 
   // Array to hold the non-empty cells found.
@@ -252,31 +228,31 @@ ClusterData kill_random_cluster(Grid& _grid, const Color target_color = Color::E
     // Keep track of which cells are non-empty in that row.
     nonempty_ndx = -1;
     target_ndx = -1;
-    for (Cell c = *row_it * WIDTH; c < (*row_it+1) * WIDTH -1; ++c)
+    for (Cell c = *row_it * WIDTH; c < (*row_it + 1) * WIDTH; ++c)
     {
       if (_grid[c] != Color::Empty)
         non_empty[++nonempty_ndx] = c;
     }
 
-    // If we just found a new empty row, update n_empty_rows.
+    // If we just found a new empty row, all the rows above it are empty too.
     if (nonempty_ndx == -1)
     {
-      _grid.n_empty_rows = *row_it;
+      _grid.n_empty_rows = *row_it + 1;
       continue;
     }
 
     // Otherwise shuffle the non-empty cells and try to kill a cluster there
     // Aim for the target color first.
-    rand_util.shuffle<WIDTH>(non_empty, nonempty_ndx);
+    rand_util.shuffle<WIDTH>(non_empty, nonempty_ndx + 1);
 
-    for (auto it = non_empty.begin(); it != non_empty.begin() + nonempty_ndx; ++it)
+    for (auto it = non_empty.begin(); it != non_empty.begin() + nonempty_ndx + 1; ++it)
     {
       if (_grid[*it] == target_color)
         ret = kill_cluster(_grid, *it);
       if (ret.size > 1)
         return ret;
     }
-    for (auto it = non_empty.begin(); it != non_empty.begin() + nonempty_ndx; ++it)
+    for (auto it = non_empty.begin(); it != non_empty.begin() + nonempty_ndx + 1; ++it)
     {
       if (_grid[*it] != target_color)
         ret = kill_cluster(_grid, *it);
@@ -288,8 +264,6 @@ ClusterData kill_random_cluster(Grid& _grid, const Color target_color = Color::E
   return ret;
 }
 
-} // namespace
-
 void input(std::istream& _in, Grid& _grid, ColorCounter& _cnt_colors)
 {
   _grid.n_empty_rows = {0};
@@ -304,6 +278,10 @@ void input(std::istream& _in, Grid& _grid, ColorCounter& _cnt_colors)
     for (auto col = 0; col < WIDTH; ++col)
     {
       _in >> _in_color;
+      if (_in_color < -1 || _in_color >= MAX_COLORS)
+        _in.setstate(std::ios::failbit);
+      if (!_in)
+        return;
       _color = to_enum<Color>(_in_color + 1);
       _grid[col + row * WIDTH] = _color;
 
@@ -311,7 +289,7 @@ void input(std::istream& _in, Grid& _grid, ColorCounter& _cnt_colors)
       if (_color != Color::Empty)
       {
         row_empty = false;
-        _cnt_colors[to_integral(_color)];
+        ++_cnt_colors[to_integral(_color)];
       }
     }
     // Count the number of empty rows (we're going from top to down)
@@ -320,25 +298,11 @@ void input(std::istream& _in, Grid& _grid, ColorCounter& _cnt_colors)
   }
 }
 
-std::vector<Cluster> get_valid_clusters(const Grid& _grid)
-{
-  std::vector<Cluster> ret;
-  ret.reserve(MAX_CELLS);
-  generate_clusters(_grid);
-  for (auto it = grid_dsu.cbegin(); it != grid_dsu.cend(); ++it)
-  {
-    if (auto ndx = std::distance(grid_dsu.cbegin(), it);
-        _grid[ndx] != Color::Empty && it->size() > 1)
-      ret.emplace_back(*it);
-  }
-  return ret;
-}
-
 bool same_as_right_nbh(const Grid& _grid, const Cell _cell)
 {
   const Color color = _grid[_cell];
   // check right if not already at the right edge of the _grid
-  if (_cell % (WIDTH - 1) != 0 && _grid[_cell + 1] == color)
+  if (cells::has_neighbour(_cell, cells::RIGHT) && _grid[_cell + 1] == color)
     return true;
   return false;
 }
@@ -353,7 +317,7 @@ bool same_as_right_or_up_nbh(const Grid& _grid, const Cell _cell)
 {
   const Color color = _grid[_cell];
   // check right if not already at the right edge of the _grid
-  if (_cell % (WIDTH - 1) != 0 && _grid[_cell + 1] == color)
+  if (cells::has_neighbour(_cell, cells::RIGHT) && _grid[_cell + 1] == color)
     return true;
   // check up if not on the first row
   if (_cell > CELL_UPPER_RIGHT && _grid[_cell - WIDTH] == color)
@@ -362,51 +326,30 @@ bool same_as_right_or_up_nbh(const Grid& _grid, const Cell _cell)
 }
 
 /**
- * Iterate through the cells like in the generate_clusters() method,
- * but returns false as soon as it identifies a cluster.
+ * Iterate through the cells from the bottom row upwards like in the
+ * generate_clusters() method, but return true as soon as it identifies
+ * a cluster.
  */
 bool has_nontrivial_cluster(const Grid& _grid)
 {
-  auto n_empty_rows = _grid.n_empty_rows;
-  bool row_empty = true;
-
-  auto row = HEIGHT - 1;
-  // Iterate from bottom row upwards so we can stop at the first empty row.
-  while (row > n_empty_rows)
+  instrument::ScopedTimer timer(kernel_stats().has_nontrivial_cluster);
+  for (auto row = HEIGHT - 1; row >= 0; --row)
   {
-    // All the row except last cell
-    for (auto cell = row * WIDTH; cell < (row + 1) * WIDTH - 1; ++cell)
+    bool row_empty = true;
+
+    for (auto cell = row * WIDTH; cell < (row + 1) * WIDTH; ++cell)
     {
       if (_grid[cell] == Color::Empty)
         continue;
       row_empty = false;
-      // compare up
-      if (_grid[cell] == _grid[cell - WIDTH])
-        return true;
-      // compare right
-      if (_grid[cell] == _grid[cell + 1])
+      if (same_as_right_or_up_nbh(_grid, cell))
         return true;
     }
-    // If the last cell of the row is empty
-    if (_grid[(row + 1) * WIDTH - 1] == Color::Empty)
-    {
-      if (row_empty)
-        return false;
-      continue;
-    }
-    // If not (compare up)
-    if (_grid[(row + 1) * WIDTH - 1] == _grid[row * WIDTH])
-      return true;
-    --row;
-    row_empty = true;
-  }
-  // The upmost non-empty row: only compare right
-  for (auto cell = 0; cell < CELL_UPPER_RIGHT - 1; ++cell)
-  {
-    if (_grid[cell] != Color::Empty && _grid[cell + 1] == _grid[cell])
-      return true;
+    // Cells are pulled down, so nothing lies above an empty row.
+    if (row_empty)
+      return false;
   }
-  return true;
+  return false;
 }
 
 /**
@@ -436,89 +379,343 @@ Cluster get_cluster(const Grid& _grid, const Cell _cell)
   {
     cur = queue.back();
     queue.pop_back();
-    // Look right
-    if (cur % WIDTH < WIDTH - 1 && seen.insert(cur + 1).second)
+    for (const Cell nbh : cells::NEIGHBOURS[cur])
     {
-      if (_grid[cur + 1] == color)
+      if (seen.insert(nbh).second && _grid[nbh] == color)
       {
-        ret.push_back(cur + 1);
-        queue.push_back(cur + 1);
+        ret.push_back(nbh);
+        queue.push_back(nbh);
       }
     }
-    // Look down
-    if (cur < (HEIGHT - 1) * WIDTH && seen.insert(cur + WIDTH).second)
+  }
+
+  return ret;
+}
+
+ClusterData get_cluster_data(const Grid& _grid, const Cell _cell)
+{
+  const Cluster cluster = get_cluster(_grid, _cell);
+  const auto rep = cluster.members.empty()
+                       ? cluster.rep
+                       : *std::min_element(cluster.members.begin(), cluster.members.end());
+  return ClusterData{.rep = static_cast<PackedCell>(rep),
+                     .color = _grid[_cell],
+                     .size = static_cast<PackedCell>(cluster.size())};
+}
+
+void get_valid_clusters_descriptors(const Grid& _grid, ClusterDataVec& _descriptors)
+{
+  instrument::ScopedTimer timer(kernel_stats().get_valid_clusters_descriptors);
+  _descriptors.clear();
+  generate_clusters(_grid);
+
+  // Only the rows below the first empty one hold clusters. Each one is reported at
+  // its smallest cell, the first one met.
+  std::array<bool, MAX_CELLS> reported{};
+  for (Cell cell = _grid.n_empty_rows * WIDTH; cell < MAX_CELLS; ++cell)
+  {
+    if (_grid[cell] == Color::Empty)
+      continue;
+    const Cell root = grid_dsu.find_rep(cell);
+    if (grid_dsu.size(root) < 2 || reported[root])
+      continue;
+    reported[root] = true;
+    _descriptors.push_back(ClusterData{.rep = static_cast<PackedCell>(cell),
+                                       .color = _grid[cell],
+                                       .size = static_cast<PackedCell>(grid_dsu.size(root))});
+  }
+}
+
+namespace {
+
+/**
+ * The cells of one color, row by row with a bit per column (the bit `col` for the
+ * cell `row * WIDTH + col`).
+ */
+using RowMask = uint64_t;
+using Plane = std::array<RowMask, HEIGHT>;
+
+/** The grids whose rows and columns fit into a RowMask get the kernels below. */
+inline constexpr bool FEW_COLORS_KERNELS = CLUSTER_MASKS;
+
+/**
+ * The cells of `row` connected horizontally to those of `seeds`, a subset of `row`:
+ * an occluded fill in both directions, in log2(WIDTH) steps.
+ */
+inline RowMask fill_row(RowMask seeds, RowMask row)
+{
+  RowMask left = seeds, right = seeds, left_prop = row, right_prop = row;
+  for (int shift = 1; shift < WIDTH; shift *= 2)
+  {
+    left |= left_prop & (left << shift);
+    left_prop &= left_prop << shift;
+    right |= right_prop & (right >> shift);
+    right_prop &= right_prop >> shift;
+  }
+  return left | right;
+}
+
+/**
+ * The valid clusters of a grid of `K` colors, by flood fills of the bit planes of
+ * the colors. The cost of a flood fill depends on the rows the cluster spans
+ * rather than on its size, which pays off when the clusters are large, that is
+ * when the colors are few. The plane `k` holds the cells of `colors[k]`.
+ *
+ * The clusters come in the order of their smallest cell, which is their rep. Each
+ * one is also handed to `on_cluster(fill, rows)`, with its cells in `fill` on the
+ * rows of the bitset `rows`.
+ */
+template<int K, typename OnCluster>
+void few_colors_descriptors(const Grid& _grid,
+                            const std::array<Color, MAX_COLORS>& colors,
+                            ClusterDataVec& _descriptors,
+                            OnCluster&& on_cluster)
+{
+  std::array<Plane, K> planes;
+  int top = 0;
+  for (int row = HEIGHT - 1; row >= 0; --row)
+  {
+    std::array<RowMask, K> masks{};
+    for (int col = 0; col < WIDTH;)
     {
-      if (_grid[cur + WIDTH] == color)
+      const Cell cell = row * WIDTH + col;
+#if defined(__SSE2__)
+      // Sixteen cells at a time, as long as they are in the grid.
+      if (cell + 16 <= MAX_CELLS)
       {
-        ret.push_back(cur + WIDTH);
-        queue.push_back(cur + WIDTH);
+        const __m128i cells =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(&*(_grid.begin() + cell)));
+        const RowMask in_row = col + 16 <= WIDTH ? 0xffff : (RowMask{1} << (WIDTH - col)) - 1;
+        for (int k = 0; k < K; ++k)
+        {
+          const __m128i same = _mm_cmpeq_epi8(cells, _mm_set1_epi8(to_integral(colors[k])));
+          masks[k] |= (static_cast<RowMask>(_mm_movemask_epi8(same)) & in_row) << col;
+        }
+        col += 16;
+        continue;
       }
+#endif
+      for (int k = 0; k < K; ++k)
+        masks[k] |= RowMask{_grid[cell] == colors[k]} << col;
+      ++col;
     }
-    // Look left
-    if (cur % WIDTH > 0 && seen.insert(cur - 1).second)
+
+    RowMask row_cells = 0;
+    for (int k = 0; k < K; ++k)
     {
-      if (_grid[cur - 1] == color)
-      {
-        ret.push_back(cur - 1);
-        queue.push_back(cur - 1);
-      }
+      planes[k][row] = masks[k];
+      row_cells |= masks[k];
     }
-    // Look up
-    if (cur > WIDTH - 1 && seen.insert(cur - WIDTH).second)
+    if (row_cells == 0)
+    {
+      top = row + 1;
+      break;
+    }
+  }
+  _grid.n_empty_rows = top;
+
+  // Drop the cells without any neighbour of their color, most of them on a
+  // random grid.
+  for (int k = 0; k < K; ++k)
+  {
+    Plane& plane = planes[k];
+    RowMask above = 0;
+    for (int row = top; row < HEIGHT; ++row)
     {
-      if (_grid[cur - WIDTH] == color)
+      const RowMask cur = plane[row];
+      const RowMask below = row + 1 < HEIGHT ? plane[row + 1] : 0;
+      plane[row] &= (cur << 1) | (cur >> 1) | above | below;
+      above = cur;
+    }
+  }
+
+  Plane fill{};
+  for (int row = top; row < HEIGHT; ++row)
+  {
+    while (true)
+    {
+      // The leftmost cell of the row in any plane seeds the next cluster.
+      RowMask any = 0;
+      for (int k = 0; k < K; ++k)
+        any |= planes[k][row];
+      if (any == 0)
+        break;
+      const RowMask seed = any & -any;
+      int k = 0;
+      while (!(planes[k][row] & seed))
+        ++k;
+      Plane& plane = planes[k];
+
+      fill[row] = fill_row(seed, plane[row]);
+      uint64_t dirty = uint64_t{1} << row;
+      uint64_t touched = dirty;
+      while (dirty)
       {
-        ret.push_back(cur - WIDTH);
-        queue.push_back(cur - WIDTH);
+        const int r = std::countr_zero(dirty);
+        dirty &= dirty - 1;
+        for (const int next : {r - 1, r + 1})
+        {
+          if (next < top || next >= HEIGHT)
+            continue;
+          const RowMask grow = fill[r] & plane[next] & ~fill[next];
+          if (grow == 0)
+            continue;
+          fill[next] |= fill_row(grow, plane[next]);
+          dirty |= uint64_t{1} << next;
+          touched |= uint64_t{1} << next;
+        }
       }
+
+      on_cluster(fill, touched);
+      int size = 0;
+      for (; touched; touched &= touched - 1)
+      {
+        const int r = std::countr_zero(touched);
+        size += std::popcount(fill[r]);
+        plane[r] &= ~fill[r];
+        fill[r] = 0;
+      }
+      _descriptors.push_back(
+          ClusterData{.rep = static_cast<PackedCell>(row * WIDTH + std::countr_zero(seed)),
+                      .color = colors[k],
+                      .size = static_cast<PackedCell>(size)});
     }
   }
-
-  return ret;
 }
 
-ClusterData get_cluster_data(const Grid& _grid, const Cell _cell)
+/**
+ * Run `few_colors_descriptors` for the number of colors of the grid.
+ *
+ * @Return false if that number has no kernel.
+ */
+template<typename OnCluster>
+bool few_colors_dispatch(const Grid& _grid,
+                         const ColorCounter& _cnt_colors,
+                         ClusterDataVec& _descriptors,
+                         OnCluster&& on_cluster)
 {
-  const Cluster cluster = get_cluster(_grid, _cell);
-  return ClusterData{
-      .rep = cluster.rep, .color = _grid[_cell], .size = cluster.size()};
+  std::array<Color, MAX_COLORS> colors{};
+  int n_colors = 0;
+  for (int color = 1; color <= MAX_COLORS; ++color)
+  {
+    if (_cnt_colors[color] > 0)
+      colors[n_colors++] = to_enum<Color>(color);
+  }
+
+  instrument::ScopedTimer timer(kernel_stats().few_colors_descriptors);
+  _descriptors.clear();
+  switch (n_colors)
+  {
+  case 1:
+    few_colors_descriptors<1>(_grid, colors, _descriptors, on_cluster);
+    return true;
+  case 2:
+    few_colors_descriptors<2>(_grid, colors, _descriptors, on_cluster);
+    return true;
+  case 3:
+    few_colors_descriptors<3>(_grid, colors, _descriptors, on_cluster);
+    return true;
+  case 4:
+    few_colors_descriptors<4>(_grid, colors, _descriptors, on_cluster);
+    return true;
+  case 5:
+    few_colors_descriptors<5>(_grid, colors, _descriptors, on_cluster);
+    return true;
+  default:
+    return false;
+  }
 }
 
-namespace {
+} // namespace
 
-/**
-    * @Return The descriptor associated to the given cluster.
-    */
-ClusterData get_descriptor(const Grid& _grid, const Cluster& _cluster)
+void get_valid_clusters_descriptors(const Grid& _grid,
+                                    const ColorCounter& _cnt_colors,
+                                    ClusterDataVec& _descriptors)
 {
-  ClusterData ret{.rep = _cluster.rep,
-                  .color = _grid[_cluster.rep],
-                  .size = _cluster.size()};
-  return ret;
+  if constexpr (FEW_COLORS_KERNELS)
+  {
+    if (few_colors_dispatch(_grid, _cnt_colors, _descriptors, [](const Plane&, uint64_t) {}))
+      return;
+  }
+  get_valid_clusters_descriptors(_grid, _descriptors);
 }
-} // namespace
 
-std::vector<ClusterData> get_valid_clusters_descriptors(const Grid& _grid)
+void get_valid_clusters_masks(const Grid& _grid,
+                              const ColorCounter& _cnt_colors,
+                              ClusterDataVec& _descriptors,
+                              std::vector<ClusterMask>& _masks)
 {
-  std::vector<ClusterData> ret{};
-
-  std::vector<Cluster> tmp = get_valid_clusters(_grid);
-  ret.reserve(tmp.size());
+  _masks.clear();
+  if constexpr (CLUSTER_MASKS)
+  {
+    auto push_mask = [&](const Plane& fill, uint64_t rows) {
+      ClusterMask& mask = _masks.emplace_back();
+      mask.rows = fill;
+      mask.cols = 0;
+      for (; rows; rows &= rows - 1)
+        mask.cols |= fill[std::countr_zero(rows)];
+    };
+    // Without any color, the grid is empty.
+    if (!few_colors_dispatch(_grid, _cnt_colors, _descriptors, push_mask))
+      _descriptors.clear();
+  }
+  else
+    get_valid_clusters_descriptors(_grid, _descriptors);
+}
 
-  std::transform(
-      tmp.begin(),
-      tmp.end(),
-      back_inserter(ret),
-      [&_grid](const auto& cluster) { return get_descriptor(_grid, cluster); });
+void remove_cluster(Grid& _grid, const ClusterMask& _mask)
+{
+  if constexpr (!CLUSTER_MASKS)
+    return;
+  instrument::ScopedTimer timer(kernel_stats().remove_cluster);
+  const int top = _grid.n_empty_rows;
+  bool emptied = false;
+  for (uint64_t cols = _mask.cols; cols; cols &= cols - 1)
+  {
+    const int col = std::countr_zero(cols);
+    // Only the removed cells are skipped: the cells above the first empty one are
+    // empty too.
+    int to = CELL_BOTTOM_LEFT + col;
+    for (int row = HEIGHT - 1; row >= top; --row)
+    {
+      const Cell from = row * WIDTH + col;
+      if (_mask.rows[row] >> col & 1)
+        continue;
+      if (_grid[from] == Color::Empty)
+        break;
+      _grid[to] = _grid[from];
+      to -= WIDTH;
+    }
+    for (; to >= top * WIDTH; to -= WIDTH)
+      _grid[to] = Color::Empty;
+    emptied |= _grid[CELL_BOTTOM_LEFT + col] == Color::Empty;
+  }
+  if (emptied)
+    pull_cells_left(_grid);
+}
 
+ClusterDataVec get_valid_clusters_descriptors(const Grid& _grid)
+{
+  ClusterDataVec ret{};
+  ret.reserve(MAX_CELLS / 2);
+  get_valid_clusters_descriptors(_grid, ret);
   return ret;
 }
 
 ClusterData apply_action(Grid& _grid, const Cell _cell)
 {
-  ClusterData cd_ret = kill_cluster(_grid, _cell);
+  int col_min;
+  return apply_action(_grid, _cell, col_min);
+}
+
+ClusterData apply_action(Grid& _grid, const Cell _cell, int& col_min)
+{
+  instrument::ScopedTimer timer(kernel_stats().apply_action);
+  int cluster_col_min;
+  ClusterData cd_ret = kill_cluster(_grid, _cell, cluster_col_min);
   if (cd_ret.size > 1)
   {
+    col_min = cluster_col_min;
     pull_cells_down(_grid);
     pull_cells_left(_grid);
   }
@@ -527,6 +724,7 @@ ClusterData apply_action(Grid& _grid, const Cell _cell)
 
 ClusterData apply_random_action(Grid& _grid, const Color target_color)
 {
+  instrument::ScopedTimer timer(kernel_stats().apply_random_action);
   ClusterData cd_ret = kill_random_cluster(_grid, target_color);
   if (cd_ret.size > 1)
   {
@@ -1,8 +1,12 @@
 #ifndef __CLUSTERUTILS_H_
 #define __CLUSTERUTILS_H_
 
+#include "instrument.h"
 #include "types.h"
+#include <array>
+#include <cstdint>
 #include <iosfwd>
+#include <vector>
 
 namespace sg {
 
@@ -15,6 +19,9 @@ namespace clusters {
 /**
  * Read a grid from a file and populate the given Grid and
  * ColorCounter of the StateData object.
+ *
+ * @Note Sets the failbit of the stream on a color out of -1..MAX_COLORS-1, and stops
+ * reading there.
  */
  void input(std::istream&, Grid&, ColorCounter&);
 
@@ -52,6 +59,12 @@ namespace clusters {
  */
 ClusterData apply_action(Grid&, const Cell);
 
+/**
+ * Same as above, also giving the leftmost column of the cluster in `col_min`
+ * when it was valid.
+ */
+ClusterData apply_action(Grid&, const Cell, int& col_min);
+
 /**
  * Same as `apply_action(Grid&, const Cell)` but a random engine
  * is used to pick the cluster at random.
@@ -60,11 +73,113 @@ ClusterData apply_action(Grid&, const Cell);
  */
  ClusterData apply_random_action(Grid&, const Color = Color::Empty);
 
+/**
+ * Populate the clusters' data structure of the grid, used by the functions
+ * looking for clusters. Exposed for the microbenchmarks.
+ *
+ * @Note This also records the number of empty rows of the grid in passing.
+ */
+void generate_clusters(const Grid&);
+
+/**
+ * Kill a random cluster, aiming for the given color first, without letting
+ * the cells drop. Exposed for the microbenchmarks.
+ *
+ * @Return The cluster that was killed, or some cluster of size 0 or 1.
+ */
+ClusterData kill_random_cluster(Grid&, const Color = Color::Empty);
+
+/**
+ * Timings of the kernels above, recorded only when compiled with SG_INSTRUMENT.
+ */
+struct KernelStats
+{
+  instrument::Timing generate_clusters;
+  instrument::Timing get_valid_clusters_descriptors;
+  instrument::Timing few_colors_descriptors;
+  instrument::Timing remove_cluster;
+  instrument::Timing has_nontrivial_cluster;
+  instrument::Timing apply_action;
+  instrument::Timing apply_random_action;
+  instrument::Timing kill_random_cluster;
+  instrument::Timing pull_cells_down;
+  instrument::Timing pull_cells_left;
+
+  friend std::ostream& operator<<(std::ostream& out, const KernelStats& stats)
+  {
+    instrument::report(out, "clusters::generate_clusters", stats.generate_clusters);
+    instrument::report(out,
+                       "clusters::get_valid_clusters_descriptors",
+                       stats.get_valid_clusters_descriptors);
+    instrument::report(
+        out, "clusters::few_colors_descriptors", stats.few_colors_descriptors);
+    instrument::report(out, "clusters::remove_cluster", stats.remove_cluster);
+    instrument::report(
+        out, "clusters::has_nontrivial_cluster", stats.has_nontrivial_cluster);
+    instrument::report(out, "clusters::apply_action", stats.apply_action);
+    instrument::report(out, "clusters::apply_random_action", stats.apply_random_action);
+    instrument::report(out, "clusters::kill_random_cluster", stats.kill_random_cluster);
+    instrument::report(out, "clusters::pull_cells_down", stats.pull_cells_down);
+    return instrument::report(out, "clusters::pull_cells_left", stats.pull_cells_left);
+  }
+};
+
+/**
+ * The kernels' timings of the calling thread. Reset them by assigning KernelStats{}.
+ */
+KernelStats& kernel_stats();
+
 /**
  * @Return the list of valid clusters transformed into ClusterDescriptors.
  */
  ClusterDataVec get_valid_clusters_descriptors(const Grid& _g);
 
+/**
+ * Same as above, but overwrite the given vector so that its capacity is reused.
+ *
+ * @Note It never allocates if the capacity of the vector is at least MAX_CELLS / 2.
+ */
+void get_valid_clusters_descriptors(const Grid& _g, ClusterDataVec& descriptors);
+
+/**
+ * Same as above, for a grid whose cells of each color are counted by the
+ * ColorCounter.
+ */
+void get_valid_clusters_descriptors(const Grid&, const ColorCounter&, ClusterDataVec&);
+
+/** The grids whose rows and columns fit into 64 bits get the ClusterMasks. */
+inline constexpr bool CLUSTER_MASKS = WIDTH <= 64 && HEIGHT <= 64;
+
+/**
+ * The cells of a cluster, row by row with a bit per column (the bit `col` for the
+ * cell `row * WIDTH + col`).
+ */
+struct ClusterMask
+{
+  std::array<uint64_t, HEIGHT> rows;
+  /** The columns where the cluster has cells. */
+  uint64_t cols;
+};
+
+/**
+ * Same as above, along with the cells of each cluster in `masks`, in the same
+ * order. The masks come out of the same flood fills as the descriptors.
+ *
+ * @Note Only for the CLUSTER_MASKS grids, the masks are left empty for the others.
+ */
+void get_valid_clusters_masks(const Grid&,
+                              const ColorCounter&,
+                              ClusterDataVec&,
+                              std::vector<ClusterMask>& masks);
+
+/**
+ * Empty the cells of the mask, let the cells above drop and pull the columns left:
+ * the same as `apply_action` on a cell of the cluster, without the flood fill, and
+ * only the columns of the cluster fall.
+ *
+ * @Note Only for the CLUSTER_MASKS grids, the others are left as they are.
+ */
+void remove_cluster(Grid&, const ClusterMask&);
 
 
 
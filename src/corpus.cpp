@@ -0,0 +1,292 @@
+#include "corpus.h"
+#include "clusterhelper.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sg::corpus {
+
+std::string test_path(const std::string& data_dir, int n)
+{
+  return data_dir + "/test" + std::to_string(n) + ".json";
+}
+
+bool read_test(const std::string& filename, State& state)
+{
+  std::ifstream ifs(filename);
+  std::string buf;
+  size_t n = std::string::npos;
+  while (n == std::string::npos && std::getline(ifs, buf))
+    n = buf.find("testIn");
+  if (n == std::string::npos)
+    return false;
+
+  // The grid is on one line, its rows being separated by literal "\n".
+  std::string cut = buf.substr(n + 10);
+  for (size_t pos; (pos = cut.find("\\n")) != std::string::npos;)
+    cut.replace(pos, 2, "\n");
+  cut = cut.substr(0, cut.find('"'));
+  std::istringstream iss{cut};
+  return read_text(iss, state);
+}
+
+void write_coordinates(std::ostream& out, const std::vector<ClusterData>& actions)
+{
+  for (const auto& action : actions)
+    out << ' ' << action.rep % WIDTH << ',' << HEIGHT - 1 - action.rep / WIDTH;
+}
+
+bool read_coordinates(std::istream& in, State state, std::vector<ClusterData>& actions)
+{
+  actions.clear();
+  int x, y;
+  char comma;
+  while (in >> x >> comma >> y)
+  {
+    if (comma != ',' || x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+      return false;
+    const ClusterData cd = state.get_cd((HEIGHT - 1 - y) * WIDTH + x);
+    if (state.is_trivial(cd) || !state.apply_action(cd))
+      return false;
+    actions.push_back(cd);
+  }
+  return in.eof();
+}
+
+bool read_text(std::istream& in, State& state)
+{
+  // Skip the blank lines, and stop cleanly at the end of the stream.
+  in >> std::ws;
+  if (in.eof())
+    return false;
+  Grid grid{};
+  ColorCounter ccolors{};
+  clusters::input(in, grid, ccolors);
+  if (!in)
+    return false;
+  state = State(std::move(grid), std::move(ccolors));
+  return true;
+}
+
+void write_text(std::ostream& out, const State& state)
+{
+  for (int row = 0; row < HEIGHT; ++row)
+  {
+    for (int col = 0; col < WIDTH; ++col)
+      out << (col ? " " : "") << to_integral(state.grid()[row * WIDTH + col]) - 1;
+    out << '\n';
+  }
+  out << '\n';
+}
+
+//************************************ Binary format ************************************/
+
+BinaryHeader BinaryHeader::current(uint64_t n_boards)
+{
+  BinaryHeader ret{};
+  std::memcpy(ret.magic, MAGIC, sizeof(MAGIC));
+  ret.version = VERSION;
+  ret.width = WIDTH;
+  ret.height = HEIGHT;
+  ret.n_colors = MAX_COLORS;
+  ret.bits_per_cell = BITS_PER_CELL;
+  ret.board_bytes = BOARD_BYTES;
+  ret.n_boards = n_boards;
+  return ret;
+}
+
+std::string BinaryHeader::check() const
+{
+  if (std::memcmp(magic, MAGIC, sizeof(MAGIC)))
+    return "not a binary corpus";
+  if (version != VERSION)
+    return "unsupported version " + std::to_string(version);
+  if (width != WIDTH || height != HEIGHT)
+    return "boards of " + std::to_string(width) + 'x' + std::to_string(height)
+           + " cells, this build plays on " + std::to_string(WIDTH) + 'x'
+           + std::to_string(HEIGHT);
+  if (n_colors > MAX_COLORS)
+    return std::to_string(n_colors) + " colors, this build plays with at most "
+           + std::to_string(MAX_COLORS);
+  if (bits_per_cell != BITS_PER_CELL || board_bytes != BOARD_BYTES)
+    return "unsupported packing";
+  return "";
+}
+
+void pack(const Grid& grid, uint8_t* out)
+{
+  Cell cell = 0;
+  for (; cell + 1 < MAX_CELLS; cell += 2)
+    *out++ = to_integral(grid[cell]) | to_integral(grid[cell + 1]) << 4;
+  if (cell < MAX_CELLS)
+    *out = to_integral(grid[cell]);
+}
+
+bool is_valid_packed(const uint8_t* in, int n_colors)
+{
+  for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+  {
+    if ((in[cell / 2] >> 4 * (cell & 1) & 0xf) > n_colors)
+      return false;
+  }
+  return true;
+}
+
+State unpack(const uint8_t* in)
+{
+  Grid grid{};
+  ColorCounter ccolors{};
+  for (Cell row = 0, cell = 0; row < HEIGHT; ++row)
+  {
+    uint8_t row_colors = 0;
+    for (int col = 0; col < WIDTH; ++col, ++cell)
+    {
+      const uint8_t color = in[cell / 2] >> 4 * (cell & 1) & 0xf;
+      grid[cell] = to_enum<Color>(color);
+      ++ccolors[color];
+      row_colors |= color;
+    }
+    grid.n_empty_rows += row_colors == 0;
+  }
+  // The counter of the empty cells isn't maintained.
+  ccolors[0] = 0;
+  return State(std::move(grid), std::move(ccolors));
+}
+
+bool BinaryWriter::open(const std::string& filename)
+{
+  m_out.open(filename, std::ios::binary | std::ios::trunc);
+  m_n_boards = 0;
+  const BinaryHeader header = BinaryHeader::current(0);
+  m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  return static_cast<bool>(m_out);
+}
+
+void BinaryWriter::add(const State& state)
+{
+  uint8_t board[BinaryHeader::BOARD_BYTES];
+  pack(state.grid(), board);
+  m_out.write(reinterpret_cast<const char*>(board), sizeof(board));
+  ++m_n_boards;
+}
+
+void BinaryWriter::add_packed(const uint8_t* boards, size_t n)
+{
+  m_out.write(reinterpret_cast<const char*>(boards), n * BinaryHeader::BOARD_BYTES);
+  m_n_boards += n;
+}
+
+bool BinaryWriter::close()
+{
+  const BinaryHeader header = BinaryHeader::current(m_n_boards);
+  m_out.seekp(0);
+  m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  const bool ret = static_cast<bool>(m_out);
+  m_out.close();
+  return ret && !m_out.fail();
+}
+
+MappedCorpus::~MappedCorpus()
+{
+  close();
+}
+
+MappedCorpus::MappedCorpus(MappedCorpus&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+MappedCorpus& MappedCorpus::operator=(MappedCorpus&& other) noexcept
+{
+  if (this != &other)
+  {
+    close();
+    p_mapping = std::exchange(other.p_mapping, nullptr);
+    m_mapping_size = std::exchange(other.m_mapping_size, 0);
+    p_boards = std::exchange(other.p_boards, nullptr);
+    m_n_boards = std::exchange(other.m_n_boards, 0);
+    m_error = std::move(other.m_error);
+  }
+  return *this;
+}
+
+bool MappedCorpus::open(const std::string& filename)
+{
+  close();
+  const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    m_error = filename + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(BinaryHeader))
+  {
+    m_error = filename + ": not a binary corpus";
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = st.st_size;
+  void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file.
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    m_error = filename + ": " + std::strerror(errno);
+    return false;
+  }
+  p_mapping = mapping;
+  m_mapping_size = size;
+
+  const auto& header = *static_cast<const BinaryHeader*>(mapping);
+  if (std::string reason = header.check(); !reason.empty())
+  {
+    m_error = filename + ": " + reason;
+    close();
+    return false;
+  }
+  if ((size - sizeof(BinaryHeader)) / BinaryHeader::BOARD_BYTES < header.n_boards)
+  {
+    m_error = filename + ": truncated, " + std::to_string(header.n_boards) + " boards expected";
+    close();
+    return false;
+  }
+  // The boards are mostly read in order.
+  ::madvise(mapping, size, MADV_SEQUENTIAL);
+  p_boards = static_cast<const uint8_t*>(mapping) + sizeof(BinaryHeader);
+  for (size_t i = 0; i < header.n_boards; ++i)
+  {
+    if (!is_valid_packed(packed(i), header.n_colors))
+    {
+      m_error = filename + ": board " + std::to_string(i) + " has colors out of range";
+      close();
+      return false;
+    }
+  }
+  m_n_boards = header.n_boards;
+  m_error.clear();
+  return true;
+}
+
+void MappedCorpus::close()
+{
+  if (p_mapping)
+    ::munmap(p_mapping, m_mapping_size);
+  p_mapping = nullptr;
+  m_mapping_size = 0;
+  p_boards = nullptr;
+  m_n_boards = 0;
+}
+
+} // namespace sg::corpus
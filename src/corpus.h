@@ -0,0 +1,200 @@
+#ifndef __CORPUS_H_
+#define __CORPUS_H_
+
+#include "samegame.h"
+
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/**
+ * Reading and writing the boards of the dataset, and the sequences played on them.
+ *
+ * Large corpora are stored in a binary format, made of a `BinaryHeader` followed by
+ * the boards, each one `board_bytes` long: the cells from the upper left one row by
+ * row, two per byte (the first one in the low half), a color from 1 to MAX_COLORS or
+ * 0 for an empty cell. The integers are little endian.
+ */
+namespace sg::corpus {
+
+/** The path of the `n`th board of the codingame dataset, e.g. data/test11.json. */
+std::string test_path(const std::string& data_dir, int n);
+
+/**
+ * Read the board of a codingame test file.
+ *
+ * @Return False if the file can't be read or holds no valid board, the state being
+ * unchanged then.
+ */
+bool read_test(const std::string& filename, State&);
+
+/**
+ * Write the actions as codingame coordinates "x,y", (0, 0) being the bottom left
+ * cell, each one preceded by a space.
+ */
+void write_coordinates(std::ostream&, const std::vector<ClusterData>&);
+
+/**
+ * Read coordinates written by `write_coordinates` up to the end of the stream, and
+ * play them from the state.
+ *
+ * @Return False if some action is invalid.
+ */
+bool read_coordinates(std::istream&, State, std::vector<ClusterData>&);
+
+/**
+ * Read the next board of a text file, in the format of data/input.txt (the colors
+ * from 0, -1 for an empty cell). The blank lines before the board are skipped, so
+ * that a file may hold several boards.
+ *
+ * @Return False at the end of the stream, or if the board is incomplete.
+ */
+bool read_text(std::istream&, State&);
+
+/** Write the board as read by `read_text`, followed by a blank line. */
+void write_text(std::ostream&, const State&);
+
+//************************************ Binary format ************************************/
+
+static_assert(std::endian::native == std::endian::little,
+              "The binary corpora are read in place, as little endian");
+
+struct BinaryHeader
+{
+  static constexpr char MAGIC[8] = {'S', 'G', 'C', 'O', 'R', 'P', 'U', 'S'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint16_t BITS_PER_CELL = 4;
+  static constexpr uint32_t BOARD_BYTES = (MAX_CELLS * BITS_PER_CELL + 7) / 8;
+
+  char magic[8];
+  uint32_t version;
+  uint16_t width;
+  uint16_t height;
+  uint16_t n_colors;
+  uint16_t bits_per_cell;
+  uint32_t board_bytes;
+  uint64_t n_boards;
+
+  /** The header of a corpus of boards of the compiled geometry. */
+  static BinaryHeader current(uint64_t n_boards);
+
+  /**
+   * @Return An empty string if the boards can be read, otherwise the reason why they
+   * can't.
+   */
+  std::string check() const;
+};
+static_assert(sizeof(BinaryHeader) == 32);
+
+/** Write the cells of the grid into `BinaryHeader::BOARD_BYTES` bytes. */
+void pack(const Grid&, uint8_t*);
+/** Whether the packed cells are empty or of one of the first `n_colors` colors. */
+bool is_valid_packed(const uint8_t*, int n_colors = MAX_COLORS);
+/** The board packed by `pack`, whose cells have to be valid. */
+State unpack(const uint8_t*);
+
+/**
+ * Write the boards one by one into a binary corpus file.
+ */
+class BinaryWriter
+{
+ public:
+  /** @Return False if the file can't be created. */
+  bool open(const std::string& filename);
+  void add(const State&);
+  /** Append `n` boards already packed by `pack`, one after the other. */
+  void add_packed(const uint8_t* boards, size_t n);
+  /**
+   * Write the number of boards into the header and close the file.
+   *
+   * @Return False if some write failed.
+   */
+  bool close();
+
+  uint64_t size() const { return m_n_boards; }
+
+ private:
+  std::ofstream m_out;
+  uint64_t m_n_boards = 0;
+};
+
+/**
+ * A binary corpus file mapped in memory. The boards are read in place: they are only
+ * unpacked into a State when accessed.
+ */
+class MappedCorpus
+{
+ public:
+  /** Unpacks the boards one at a time. */
+  class iterator
+  {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = State;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = State;
+
+    iterator() = default;
+    iterator(const MappedCorpus* corpus, size_t ndx) : p_corpus(corpus), m_ndx(ndx) {}
+
+    State operator*() const { return (*p_corpus)[m_ndx]; }
+    iterator& operator++()
+    {
+      ++m_ndx;
+      return *this;
+    }
+    iterator operator++(int)
+    {
+      iterator ret = *this;
+      ++m_ndx;
+      return ret;
+    }
+    bool operator==(const iterator& other) const { return m_ndx == other.m_ndx; }
+
+   private:
+    const MappedCorpus* p_corpus = nullptr;
+    size_t m_ndx = 0;
+  };
+
+  MappedCorpus() = default;
+  ~MappedCorpus();
+  MappedCorpus(MappedCorpus&&) noexcept;
+  MappedCorpus& operator=(MappedCorpus&&) noexcept;
+  MappedCorpus(const MappedCorpus&) = delete;
+  MappedCorpus& operator=(const MappedCorpus&) = delete;
+
+  /**
+   * Map the file, after checking its header and the cells of every board.
+   *
+   * @Return False on failure, see `error()`.
+   */
+  bool open(const std::string& filename);
+  void close();
+  const std::string& error() const { return m_error; }
+
+  size_t size() const { return m_n_boards; }
+  /** The packed cells of the `i`th board, in the mapping. */
+  const uint8_t* packed(size_t i) const
+  {
+    return p_boards + i * BinaryHeader::BOARD_BYTES;
+  }
+  State operator[](size_t i) const { return unpack(packed(i)); }
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, m_n_boards); }
+
+ private:
+  void* p_mapping = nullptr;
+  size_t m_mapping_size = 0;
+  const uint8_t* p_boards = nullptr;
+  size_t m_n_boards = 0;
+  std::string m_error;
+};
+
+} // namespace sg::corpus
+
+#endif
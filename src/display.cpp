@@ -90,8 +90,6 @@ std::string print_cell(
   }
 }
 
-const int x_labels[15]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
-
 const std::string
 to_string(const Grid& grid, const Cell cell, sg::Output output_mode)
 {
@@ -118,9 +116,9 @@ to_string(const Grid& grid, const Cell cell, sg::Output output_mode)
 
   if (labels)
   {
-    ss << std::string(34, '_') << '\n' << std::string(5, ' ');
+    ss << std::string(4 + 2 * WIDTH, '_') << '\n' << std::string(5, ' ');
 
-    for (int x : x_labels)
+    for (int x = 0; x < WIDTH; ++x)
       ss << x << ((x < 10) ? " " : "");
     ss << '\n';
   }
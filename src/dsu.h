@@ -1,6 +1,7 @@
 #ifndef __DSU_H_
 #define __DSU_H_
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <iosfwd>
@@ -192,6 +193,65 @@ class DSU
   ClusterList m_clusters;
 };
 
+/**
+ * Same partition as `DSU`, but keeping only the parent and the size of each cluster
+ * in flat arrays instead of the list of its members. Resetting and merging never
+ * allocate, and for the same sequence of `unite` calls the representatives are the
+ * same as those of `DSU`.
+ */
+template<typename Index, size_t N>
+class FlatDSU
+{
+ public:
+  using size_type = Index;
+
+  constexpr FlatDSU() { reset(); }
+
+  constexpr void reset()
+  {
+    m_parent = IDENTITY;
+    m_size.fill(1);
+  }
+
+  Index find_rep(Index ndx)
+  {
+    if (m_parent[ndx] != ndx)
+      return m_parent[ndx] = find_rep(m_parent[ndx]);
+    return ndx;
+  }
+
+  void unite(Index a, Index b)
+  {
+    a = find_rep(a);
+    b = find_rep(b);
+
+    if (a != b)
+    {
+      // Merge the smaller cluster into the bigger one.
+      if (m_size[a] < m_size[b])
+        std::swap(a, b);
+      m_parent[b] = a;
+      m_size[a] += m_size[b];
+    }
+  }
+
+  bool is_rep(Index ndx) const { return m_parent[ndx] == ndx; }
+  /** The size of the cluster, only meaningful for a representative. */
+  size_type size(Index rep) const { return m_size[rep]; }
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  /** Every index its own rep, baked into the binary. */
+  static constexpr std::array<Index, N> IDENTITY = []() {
+    std::array<Index, N> ret{};
+    std::iota(ret.begin(), ret.end(), Index{0});
+    return ret;
+  }();
+
+  std::array<Index, N> m_parent;
+  std::array<size_type, N> m_size;
+};
+
 // We define the template function which was forward declared at the beginnning.
 // When writing _out << cluster on an instantiated ClusterT<typename T, T t> for some
 // T, the compiler will find this function and know it can access cluster's private members,
@@ -1,12 +1,29 @@
 #include <array>
 #include <algorithm>
+#include <cstdint>
+
+/**
+ * The geometry of the boards is fixed at compile time, 15x15 as on codingame unless
+ * -DSG_WIDTH=... -DSG_HEIGHT=... say otherwise (see the SG_BOARD_WIDTH and
+ * SG_BOARD_HEIGHT CMake options), e.g. 50x50 for the large puzzles.
+ */
+#ifndef SG_WIDTH
+#define SG_WIDTH 15
+#endif
+#ifndef SG_HEIGHT
+#define SG_HEIGHT 15
+#endif
 
 namespace sg {
 
-inline constexpr auto WIDTH = 15;
-inline constexpr auto HEIGHT = 15;
+inline constexpr auto WIDTH = SG_WIDTH;
+inline constexpr auto HEIGHT = SG_HEIGHT;
+static_assert(WIDTH > 1 && HEIGHT > 1 && WIDTH * HEIGHT < 0xffff,
+              "The cells are packed into 16 bits");
 inline constexpr auto MAX_COLORS = 5;
 inline constexpr auto MAX_CELLS = HEIGHT * WIDTH;
+/** Each action removes at least two cells. */
+inline constexpr auto MAX_ACTIONS = MAX_CELLS / 2;
 inline constexpr auto CELL_UPPER_LEFT = 0;
 inline constexpr auto CELL_UPPER_RIGHT = WIDTH - 1;
 inline constexpr auto CELL_BOTTOM_LEFT = (HEIGHT - 1) * WIDTH;
@@ -14,7 +31,7 @@ inline constexpr auto CELL_BOTTOM_RIGHT = MAX_CELLS - 1;
 inline constexpr auto CELL_NONE = MAX_CELLS;
 
 typedef int Cell;
-enum class Color
+enum class Color : uint8_t
 {
   Empty = 0,
   Nb = MAX_COLORS + 1
@@ -0,0 +1,158 @@
+#ifndef __INSTRUMENT_H_
+#define __INSTRUMENT_H_
+
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+
+/**
+ * Counters and timers for the hot paths, compiled in with -DSG_INSTRUMENT only
+ * (see the SG_INSTRUMENT CMake option). Without it, the timers are empty objects
+ * and the recording functions do nothing, so that the optimizer removes them.
+ *
+ * With -DSG_PERF_COUNTERS (which implies SG_INSTRUMENT), the timers also record
+ * the hardware counters of perf::ThreadCounters over their scope. This costs a
+ * read() system call at each end of the scope, so the numbers of the shortest
+ * kernels include some of that overhead.
+ */
+#if defined(SG_PERF_COUNTERS) && !defined(SG_INSTRUMENT)
+#define SG_INSTRUMENT
+#endif
+
+namespace instrument {
+
+#if defined(SG_INSTRUMENT)
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+/**
+ * Number of calls of some function, with their total and maximum duration.
+ */
+struct Timing
+{
+  uint64_t calls = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+  /** Totals of the hardware counters, with SG_PERF_COUNTERS only. */
+  perf::Counts hw{};
+
+  void record(uint64_t ns)
+  {
+    ++calls;
+    total_ns += ns;
+    max_ns = std::max(max_ns, ns);
+  }
+  double avg_ns() const { return calls ? double(total_ns) / calls : 0.0; }
+};
+
+/**
+ * Number of samples of some quantity (e.g. a depth), with their total and maximum.
+ */
+struct Tally
+{
+  uint64_t samples = 0;
+  uint64_t total = 0;
+  uint64_t max = 0;
+
+  void record(uint64_t value)
+  {
+    if constexpr (enabled)
+    {
+      ++samples;
+      total += value;
+      max = std::max(max, value);
+    }
+  }
+  double avg() const { return samples ? double(total) / samples : 0.0; }
+};
+
+/**
+ * Add the time elapsed between its construction and destruction to a Timing.
+ */
+class ScopedTimer
+{
+ public:
+#if defined(SG_INSTRUMENT)
+  explicit ScopedTimer(Timing& timing)
+    : r_timing(timing)
+  {
+#if defined(SG_PERF_COUNTERS)
+    m_hw_start = perf::ThreadCounters::get().read();
+#endif
+    m_start = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer()
+  {
+    r_timing.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - m_start)
+                        .count());
+#if defined(SG_PERF_COUNTERS)
+    r_timing.hw += perf::ThreadCounters::get().read() - m_hw_start;
+#endif
+  }
+
+ private:
+  Timing& r_timing;
+  std::chrono::steady_clock::time_point m_start;
+#if defined(SG_PERF_COUNTERS)
+  perf::Counts m_hw_start;
+#endif
+#else
+  explicit ScopedTimer(Timing&) {}
+#endif
+
+ public:
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+inline std::ostream& report(std::ostream& out, std::string_view name, const Timing& t)
+{
+  out << std::left << std::setw(42) << name << std::right << std::setw(12) << t.calls
+      << " calls" << std::setw(14) << t.total_ns / 1000 << " us total" << std::fixed
+      << std::setprecision(1) << std::setw(12) << t.avg_ns() << " ns avg"
+      << std::setw(12) << t.max_ns << " ns max\n";
+  if (t.hw.empty() || t.calls == 0)
+    return out;
+
+  auto per_call = [&t](perf::Event e) { return double(t.hw[e]) / t.calls; };
+  return out << std::setw(42) << "" << std::setprecision(1) << std::setw(12)
+             << per_call(perf::cycles) << " cycles" << std::setw(12)
+             << per_call(perf::instructions) << " instr." << std::setprecision(2)
+             << std::setw(8) << t.hw.ipc() << " IPC" << std::setw(10)
+             << per_call(perf::cache_misses) << " cache misses" << std::setw(10)
+             << per_call(perf::branch_misses) << " branch misses (per call)\n";
+}
+
+/**
+ * Whether the hardware counters are recorded, and which ones are missing.
+ */
+inline std::ostream& report_hw_status(std::ostream& out)
+{
+#if defined(SG_PERF_COUNTERS)
+  const auto& counters = perf::ThreadCounters::get();
+  if (!counters.available())
+    return out << "Hardware counters unavailable: " << counters.status() << '\n';
+  if (!counters.status().empty())
+    return out << "Some hardware counters are unavailable: " << counters.status() << '\n';
+#endif
+  return out;
+}
+
+inline std::ostream& report(std::ostream& out, std::string_view name, const Tally& t)
+{
+  return out << std::left << std::setw(42) << name << std::right << std::setw(12)
+             << t.samples << " samples" << std::fixed << std::setprecision(2)
+             << std::setw(12) << t.avg() << " avg" << std::setw(12) << t.max << " max\n";
+}
+
+} // namespace instrument
+
+#endif
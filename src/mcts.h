@@ -3,24 +3,65 @@
 // - is_trivial(const ActionT& action) determining if an action is trivial.
 // - evaluate(const ActionT& action)
 // - evaluate_terminal()
-// - valid_actions_data() returning a vector containing all valid actions
+// - valid_actions_data(std::vector<ActionT>&) overwriting the vector with all valid actions
 // - apply_random_action()
 // - apply_action(const ActionT& action)
 // - key()
+//
+// and may implement generate_children(std::vector<ActionT>&, std::vector<StateT>&)
+// building the children of the state along with its valid actions, which the `full`
+// ExpansionStrategy then uses, and the methods of policies::HasCanonicalActions for
+// `set_canonical_order`.
 
 #ifndef __MCTS_H_
 #define __MCTS_H_
 
+#include "instrument.h"
 #include "mcts_tree.h"
 #include "policies.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <ostream>
+#include <vector>
+
 namespace mcts {
 
+/**
+ * Where the time of the search goes, per phase. Only recorded when compiled with
+ * SG_INSTRUMENT, see instrument.h.
+ *
+ * @Note The expansion includes the playouts.
+ */
+struct SearchStats
+{
+  instrument::Timing select_leaf;
+  instrument::Timing expand_current_node;
+  instrument::Timing simulate_playout;
+  instrument::Timing backpropagate;
+  /** Number of edges traversed by each selection. */
+  instrument::Tally selection_depth;
+  /** Number of actions of each playout. */
+  instrument::Tally playout_length;
+
+  friend std::ostream& operator<<(std::ostream& out, const SearchStats& stats)
+  {
+    instrument::report(out, "select_leaf", stats.select_leaf);
+    instrument::report(out, "expand_current_node", stats.expand_current_node);
+    instrument::report(out, "simulate_playout", stats.simulate_playout);
+    instrument::report(out, "backpropagate", stats.backpropagate);
+    instrument::report(out, "selection depth", stats.selection_depth);
+    return instrument::report(out, "playout length", stats.playout_length);
+  }
+};
+
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor = policies::Default_UCB_Func,
          typename Playout_Functor = typename policies::Default_Playout_Func<StateT, ActionT>,
-         size_t MAX_DEPTH = 128>
+         size_t INITIAL_DEPTH = 128>
 class Mcts
 {
  public:
@@ -41,14 +82,22 @@ class Mcts
     by_avg_value,
     by_best_value
   };
+  enum class ExpansionStrategy
+  {
+    full,
+    progressive
+  };
 
   Mcts(StateT& state,
-       UCB_Functor ucb_func = policies::Default_UCB_Func{})
+       UCB_Functor ucb_func = UCB_Functor{})
     : m_state(state),
       m_tree(state.key()),
       p_current_node(m_tree.get_root()),
       m_root_state(state),
-      UCB_Func(ucb_func)
+      UCB_Func(ucb_func),
+      m_path(INITIAL_DEPTH),
+      m_playout(INITIAL_DEPTH),
+      m_best_line(INITIAL_DEPTH)
   {
   }
 
@@ -56,12 +105,34 @@ class Mcts
   ActionSequence
       best_action_sequence(ActionSelection = ActionSelection::by_best_value);
 
+  /**
+     * Run the algorithm, then play at the root the first action of the sequence that
+     * `best_action_sequence` would return. The tree below that action and the best
+     * line are kept for the next searches.
+     *
+     * @Return The action played, trivial if the root state is terminal.
+     */
+  ActionT best_sequence_action(ActionSelection = ActionSelection::by_best_value);
+
+  /**
+     * Run the algorithm until the `computation_resources()` returns false, growing
+     * the current tree.
+     */
+  void run();
+
+  /**
+     * The sequence `best_action_sequence` would return, without running the algorithm
+     * first. The search can go on afterwards with `run()`.
+     */
+  ActionSequence peek_best_sequence(ActionSelection = ActionSelection::by_best_value);
+
  private:
-  using Tree = MctsTree<StateT, ActionT, MAX_DEPTH>;
+  using Tree = MctsTree<StateT, ActionT, INITIAL_DEPTH>;
   using node_type = typename Tree::Node;
   using edge_type = typename Tree::Edge;
+  using edge_index = typename Tree::edge_index;
   using node_pointer = typename Tree::node_pointer;
-  using edge_pointer = typename Tree::edge_pointer;
+  using MemoryUsage = typename Tree::MemoryUsage;
 
   StateT& m_state;
   Tree m_tree;
@@ -70,21 +141,42 @@ class Mcts
   ActionSequence m_actions_done;
   UCB_Functor UCB_Func;
 
+  // Reused by every expansion, so that its capacity soon stops growing.
+  ActionSequence m_valid_actions;
+  std::vector<StateT> m_children;
+
+  // The actions leading from the root to the current node. The three buffers have
+  // the same size, INITIAL_DEPTH at first, and grow together as deeper lines are met.
+  using ActionBuffer = std::vector<ActionT>;
+  ActionBuffer m_path;
+  size_t m_path_len = 0;
+  reward_type m_path_val = 0.0;
+
+  // The actions of the current playout start at index `m_path_len`.
+  ActionBuffer m_playout;
+
+  // The best line found so far by a playout, starting from the root.
+  ActionBuffer m_best_line;
+  size_t m_best_line_len = 0;
+  reward_type m_best_line_val = std::numeric_limits<reward_type>::lowest();
+
   // Parameters
   double exploration_constant = 0.4;
   BackpropagationStrategy backpropagation_strategy =
       BackpropagationStrategy::avg_value;
+  ExpansionStrategy expansion_strategy = ExpansionStrategy::full;
+  bool canonical_order = false;
+  double widening_constant = 2.0;
+  double widening_exponent = 0.5;
   unsigned int max_iterations;
   unsigned int max_time = 20000;
   bool use_time = (max_time > 0);
+  const std::atomic<bool>* p_stop_flag = nullptr;
 
   // Counters
   unsigned int iteration_cnt = 0;
-
-  /**
-     * Run the algorithm until the `computation_resources()` returns false.
-     */
-  void run();
+  std::chrono::steady_clock::time_point m_start_time;
+  SearchStats m_stats;
 
   /**
      * Complete a full cycle of the algorithm.
@@ -94,12 +186,12 @@ class Mcts
   /**
      * Select the best edge from the current node according to the given method.
      */
-  edge_pointer get_best_edge(ActionSelection);
+  edge_index get_best_edge(ActionSelection);
 
   /**
    * The *Selection* phase of the algorithm.
    */
-  edge_pointer Select_next_edge();
+  edge_index Select_next_edge();
 
   /**
      * Traverse the tree to the next leaf to be expanded, using the ucb criterion
@@ -108,35 +200,112 @@ class Mcts
   void select_leaf();
 
   /**
-     * Play a random actions from the current state starting at the given action, until
-     * the state is terminal. Return the total score.
+     * Apply the edge's action to a copy of the current state, then play actions given by
+     * the `Playout_Functor` until the state is terminal. Return the total score.
      *
-     * The function is templated so that we can specify how to call state.apply_random_action()
-     * depending on the context.
+     * @Note If the action leads to a terminal state, the edge is marked as completed
+     * since its value is then exact.
+     *
+     * @Note The actions played are written in `m_playout` and the line is recorded if
+     * it beats the best one so far.
+     */
+  reward_type simulate_playout(edge_index);
+
+  /** Same as above, from the state the edge's action leads to. */
+  reward_type simulate_playout(edge_index, StateT& child);
+
+  /**
+     * Play actions given by the `Playout_Functor` from `child`, reached by the edge,
+     * until it is terminal, see `simulate_playout`.
      */
-  reward_type simulate_playout(const ActionT&);
+  reward_type playout_from(edge_index, StateT& child);
 
   /**
-     * For when the current node is a leaf, run `simulate_playout` on all the state's
-     * valid actions and populate the current node with children edges corresponding
-     * to those actions.
+     * For when the current node is a leaf, populate it with children edges corresponding
+     * to the state's valid actions.
+     *
+     * With the `full` ExpansionStrategy, run `simulate_playout` on all of them, from
+     * children built along with the actions if the state can. With the `progressive` one, the edges are ordered by decreasing immediate reward and only the
+     * first one gets a playout. The next ones are expanded one at a time on later visits,
+     * as allowed by `can_widen`.
      *
      * @Note This increments the node's number of visits by 1 (and only does that when the
      * node had been visited before but is terminal).
      */
   void expand_current_node();
 
+  /**
+     * Simulate a playout from the next unexpanded edge of the current node and add
+     * it to the tree.
+     */
+  void expand_next_edge();
+
+  /** Same as above, with the child of the edge already built. */
+  void expand_next_edge(StateT& child);
+
+  /** The valid actions of the current state, only the canonical ones if asked. */
+  void current_actions(ActionSequence& actions)
+  {
+    if constexpr (policies::HasCanonicalActions<StateT, ActionT>)
+    {
+      if (canonical_order)
+        return m_state.canonical_actions_data(actions);
+    }
+    m_state.valid_actions_data(actions);
+  }
+
+  /** Same as above, along with the states they lead to. */
+  void current_children(ActionSequence& actions, std::vector<StateT>& children)
+  {
+    if constexpr (policies::HasCanonicalActions<StateT, ActionT>)
+    {
+      if (canonical_order)
+        return m_state.generate_canonical_children(actions, children);
+    }
+    m_state.generate_children(actions, children);
+  }
+
+  /** The key of the node of the state, see `set_canonical_order`. */
+  auto node_key(StateT& state) const
+  {
+    if constexpr (policies::HasCanonicalActions<StateT, ActionT>)
+    {
+      if (canonical_order)
+        return state.canonical_key();
+    }
+    return state.key();
+  }
+
+  /**
+     * With the `progressive` ExpansionStrategy, return true if a node can get a new
+     * child. That is, if it has less than `widening_constant * n_visits^widening_exponent`
+     * children, or if all of its children are completed.
+     */
+  bool can_widen(node_pointer);
+
   /**
      * After expanding the leaf node, update the statistics of all edges connecting it
      * to the root with the results obtained from the simulated playouts, according to
      * the set BackpropagationStrategy.
+     *
+     * @Note When the leaf is solved, its exact value is propagated instead and the edges
+     * above it are marked as completed as far up as their siblings allow (MCTS-Solver).
      */
   void backpropagate();
 
+  /**
+     * Record the line made of the current path followed by the first `len - m_path_len`
+     * actions of the current playout, if its value beats that of the best line so far.
+     */
+  void record_line(size_t len, reward_type val);
+
+  /** Double the size of the action buffers. */
+  void grow_buffers();
+
   /**
      * Apply the edge's action to the state and update `m_current_node`.
      */
-  void traverse_edge(edge_pointer);
+  void traverse_edge(edge_index);
 
   /**
      * Resets `m_current_node` with a reference to the root node, and reset the
@@ -145,12 +314,19 @@ class Mcts
   void return_to_root();
 
   /**
-     * Apply the edge's action to the state and change the root to be that
+     * Apply the action to the root state and change the root to be that
      * new state.
      *
-     * @Note The action is pushed at the back of `m_actions_done`.
+     * @Note The action is pushed at the back of `m_actions_done`, and the best line
+     * is kept if it starts with that action.
+     */
+  void apply_root_action(const ActionT& action);
+
+  /**
+     * Return the sequence of actions computed by `best_traversal`, or the best line
+     * found by a playout during the search if its value is higher.
      */
-  void apply_root_action(const edge_type& edge);
+  ActionSequence best_sequence(ActionSelection);
 
   /**
      * Using the given selection method, return the best path from root to leaf according to
@@ -181,17 +357,73 @@ class Mcts
    */
   void init_counters();
 
+  /**
+   * The time elapsed since the last `init_counters()`, in milliseconds.
+   */
+  std::chrono::milliseconds::rep time_elapsed() const;
+
  public:
   void set_exploration_constant(double c) { exploration_constant = c; }
   void set_backpropagation_strategy(BackpropagationStrategy strat)
   {
     backpropagation_strategy = strat;
   }
+  void set_expansion_strategy(ExpansionStrategy strat)
+  {
+    expansion_strategy = strat;
+  }
+  /**
+   * Only expand the canonical actions of the states (see
+   * `State::canonical_actions_data`), so that two actions which commute are only
+   * tried in one order. Does nothing for the states without canonical actions.
+   *
+   * @Note The nodes are then keyed by `canonical_key`, and the subtree of the root
+   * is only kept from one action played to the next if its actions were all
+   * canonical.
+   */
+  void set_canonical_order(bool canonical)
+  {
+    if constexpr (policies::HasCanonicalActions<StateT, ActionT>)
+    {
+      canonical_order = canonical;
+      m_root_state.clear_last_action();
+      m_tree.set_root(node_key(m_root_state));
+      return_to_root();
+    }
+  }
+  void set_widening_parameters(double cst, double exponent)
+  {
+    widening_constant = cst;
+    widening_exponent = exponent;
+  }
   void set_max_iterations(unsigned int n) { max_iterations = n; }
   void set_max_time(unsigned int t) { max_time = t; }
+  /**
+   * Make `run()` return as soon as the flag is set, possibly by another thread, on
+   * top of the time and iterations limits. Pass nullptr to remove it.
+   */
+  void set_stop_flag(const std::atomic<bool>* flag) { p_stop_flag = flag; }
+  /**
+   * Allocate the tree up front, so that the search runs without any allocation
+   * until the tree holds that many nodes and edges.
+   */
+  void reserve(size_t n_nodes, size_t n_edges) { m_tree.reserve(n_nodes, n_edges); }
 
   unsigned int get_iterations_cnt() { return iteration_cnt; }
   size_t get_n_nodes() { return m_tree.size(); }
+  /** The visits of the root, including those made before it became the root. */
+  int get_root_visits() const { return m_tree.root().n_visits; }
+  /** True once the values of the whole tree are exact, `run()` then returns at once. */
+  bool is_solved() const { return m_tree.root_solved(); }
+  MemoryUsage get_memory_usage() const { return m_tree.memory_usage(); }
+  /** Empty unless compiled with SG_INSTRUMENT. */
+  const SearchStats& get_stats() const { return m_stats; }
+  /** The best line found by a playout so far, from the root, and its value. */
+  std::pair<ActionSequence, reward_type> get_best_line() const
+  {
+    return {ActionSequence(m_best_line.begin(), m_best_line.begin() + m_best_line_len),
+            m_best_line_val};
+  }
 };
 
 } // namespace mcts
@@ -14,60 +14,84 @@
 #include <vector>
 
 namespace mcts {
-namespace timer {
 
-std::chrono::time_point<std::chrono::steady_clock> start;
-
-std::chrono::milliseconds::rep time_elapsed()
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+ActionT Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::best_action(
+    ActionSelection method)
 {
-  return std::chrono::duration_cast<std::chrono::milliseconds>(
-             std::chrono::steady_clock::now() - start)
-      .count();
+  run();
+  const ActionT action = m_tree.action(get_best_edge(method));
+  apply_root_action(action);
+  return action;
 }
 
-} // namespace timer
-
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-ActionT Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::best_action(
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::ActionSequence
+inline Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::best_action_sequence(
     ActionSelection method)
 {
   run();
-  auto* edge = get_best_edge(method);
-  apply_root_action(*edge);
-  return edge->action;
+  return best_sequence(method);
 }
 
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::ActionSequence
-inline Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::best_action_sequence(
+         size_t INITIAL_DEPTH>
+ActionT Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::best_sequence_action(
     ActionSelection method)
 {
   run();
-  return best_traversal(method);
+  const size_t n_done = m_actions_done.size();
+  best_sequence(method);
+  const ActionT action = m_actions_done.size() > n_done ? m_actions_done[n_done] : ActionT{};
+  m_actions_done.resize(n_done);
+
+  if (m_root_state.is_trivial(action))
+  {
+    return_to_root();
+    return action;
+  }
+  apply_root_action(action);
+  return action;
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::ActionSequence
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::peek_best_sequence(
+    ActionSelection method)
+{
+  const size_t n_done = m_actions_done.size();
+  ActionSequence ret(best_sequence(method));
+  m_actions_done.resize(n_done);
+  return_to_root();
+  return ret;
 }
 
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::run()
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::run()
 {
   init_counters();
   p_current_node = m_tree.get_root();
-  if (p_current_node->n_visits > 0 && p_current_node->children.size() == 0)
-  {
-    return;
-  }
-  while (computation_resources())
+  // Stop as soon as the whole tree is solved.
+  while (computation_resources() && !m_tree.root_solved())
   {
     step();
   }
@@ -77,13 +101,23 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::step()
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::step()
 {
   return_to_root();
-  select_leaf();
-  expand_current_node();
-  backpropagate();
+  {
+    instrument::ScopedTimer phase_timer(m_stats.select_leaf);
+    select_leaf();
+  }
+  m_stats.selection_depth.record(m_path_len);
+  {
+    instrument::ScopedTimer phase_timer(m_stats.expand_current_node);
+    expand_current_node();
+  }
+  {
+    instrument::ScopedTimer phase_timer(m_stats.backpropagate);
+    backpropagate();
+  }
   ++iteration_cnt;
 }
 
@@ -91,14 +125,14 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::select_leaf()
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::select_leaf()
 {
-  while (p_current_node->n_visits > 0 && p_current_node->children.size() > 0)
+  while (p_current_node->n_visits > 0 && p_current_node->n_expanded > 0
+         && !m_tree.is_solved(p_current_node) && !can_widen(p_current_node))
   {
     ++p_current_node->n_visits;
-    edge_pointer edge = get_best_edge(ActionSelection::by_ucb);
-    traverse_edge(edge);
+    traverse_edge(get_best_edge(ActionSelection::by_ucb));
   }
 }
 
@@ -106,52 +140,101 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::edge_pointer
-Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::get_best_edge(
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::edge_index
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::get_best_edge(
     ActionSelection method)
 {
-  auto cmp = [&](const auto& a, const auto& b) {
-    if (method == ActionSelection::by_ucb)
-    {
-      auto ucb = UCB_Func(std::move(exploration_constant),
-                          std::move(p_current_node->n_visits));
-      return ucb(a) < ucb(b);
-    }
-    if (method == ActionSelection::by_n_visits)
-      return a.n_visits < b.n_visits;
-    if (method == ActionSelection::by_avg_value)
-      return a.avg_val < b.avg_val;
-    return a.best_val < b.best_val;
-  };
+  const auto expanded = m_tree.expanded(p_current_node);
+  const edge_index first = p_current_node->first_edge;
+
+  // Completed edges are skipped by the UCB selection.
+  if (method == ActionSelection::by_ucb)
+    return first
+           + policies::select_ucb(
+               UCB_Func, exploration_constant, p_current_node->n_visits, expanded);
 
-  return &*std::max_element(
-      p_current_node->children.begin(), p_current_node->children.end(), cmp);
+  auto argmax = [&](const auto* values) {
+    return first + std::distance(values, std::max_element(values, values + expanded.size));
+  };
+  if (method == ActionSelection::by_n_visits)
+    return argmax(expanded.n_visits);
+  if (method == ActionSelection::by_avg_value)
+    return argmax(expanded.avg_val);
+  return argmax(expanded.best_val);
 }
 
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
+         size_t INITIAL_DEPTH>
 typename StateT::reward_type
-Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::simulate_playout(
-    const ActionT& action)
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::simulate_playout(
+    edge_index edge)
 {
-  ActionT _action = action;
-  reward_type score = 0.0;
+  instrument::ScopedTimer phase_timer(m_stats.simulate_playout);
 
   // Make a copy since the `apply_action()` methods mutate the state.
   StateT tmp_state = m_state;
+  tmp_state.apply_action(m_tree.action(edge));
+  return playout_from(edge, tmp_state);
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+typename StateT::reward_type
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::simulate_playout(
+    edge_index edge, StateT& child)
+{
+  instrument::ScopedTimer phase_timer(m_stats.simulate_playout);
+  return playout_from(edge, child);
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+typename StateT::reward_type
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::playout_from(
+    edge_index edge, StateT& tmp_state)
+{
+  const ActionT& action = m_tree.action(edge);
+  size_t len = m_path_len;
+
+  if (len == m_playout.size())
+    grow_buffers();
+  m_playout[len++] = action;
+  reward_type score = tmp_state.evaluate(action);
+
+  // The value of a terminal child is exact.
+  if (tmp_state.is_terminal())
+  {
+    m_tree.edges().subtree_completed[edge] = true;
+    score += tmp_state.evaluate_terminal();
+    record_line(len, m_path_val + score);
+    m_stats.playout_length.record(len - m_path_len);
+    return score;
+  }
 
   Playout_Functor Playout_Func(tmp_state);
+  ActionT _action = Playout_Func();
 
   while (!tmp_state.is_trivial(_action))
   {
       score += tmp_state.evaluate(_action);
+      if (len == m_playout.size())
+        grow_buffers();
+      m_playout[len++] = _action;
       _action = Playout_Func();
   }
   score += tmp_state.evaluate_terminal();
+  record_line(len, m_path_val + score);
+  m_stats.playout_length.record(len - m_path_len);
 
   return score;
 }
@@ -160,26 +243,85 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::expand_current_node()
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::record_line(
+    size_t len, reward_type val)
+{
+  if (val <= m_best_line_val)
+    return;
+
+  std::copy(m_path.begin(), m_path.begin() + m_path_len, m_best_line.begin());
+  std::copy(m_playout.begin() + m_path_len,
+            m_playout.begin() + len,
+            m_best_line.begin() + m_path_len);
+  m_best_line_len = len;
+  m_best_line_val = val;
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::grow_buffers()
+{
+  const size_t size = 2 * m_path.size();
+  m_path.resize(size);
+  m_playout.resize(size);
+  m_best_line.resize(size);
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::expand_current_node()
 {
   if (p_current_node->n_visits > 0)
   {
+    if (can_widen(p_current_node))
+      expand_next_edge();
     ++p_current_node->n_visits;
     return;
   }
 
-  auto valid_actions = m_state.valid_actions_data();
-
-  for (auto a : valid_actions)
+  auto& valid_actions = m_valid_actions;
+  if constexpr (policies::GeneratesChildren<StateT, ActionT>)
+  {
+    // All the children get a playout right away.
+    if (expansion_strategy == ExpansionStrategy::full)
     {
-      edge_type new_edge{
-         .action = a,
-       };
-      auto best_val = simulate_playout(a);
-      new_edge.avg_val = new_edge.best_val = best_val;
-      p_current_node->children.push_back(new_edge);
+      current_children(valid_actions, m_children);
+      m_tree.add_children(p_current_node, valid_actions);
+      for (auto& child : m_children)
+        expand_next_edge(child);
+      ++p_current_node->n_visits;
+      return;
     }
+  }
+  current_actions(valid_actions);
+
+  if (expansion_strategy == ExpansionStrategy::progressive)
+  {
+    // Try the actions with the biggest immediate reward first. This is a stable
+    // insertion sort, since std::stable_sort allocates a buffer.
+    auto by_reward = [&](const auto& a, const auto& b) { return evaluate(a) > evaluate(b); };
+    for (auto it = valid_actions.begin(); it != valid_actions.end(); ++it)
+      std::rotate(std::upper_bound(valid_actions.begin(), it, *it, by_reward), it, it + 1);
+  }
+
+  m_tree.add_children(p_current_node, valid_actions);
+
+  if (expansion_strategy == ExpansionStrategy::full)
+  {
+    while (!p_current_node->fully_expanded())
+      expand_next_edge();
+  }
+  else if (!p_current_node->fully_expanded())
+  {
+    expand_next_edge();
+  }
 
   ++p_current_node->n_visits;
 }
@@ -188,43 +330,80 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::backpropagate()
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::expand_next_edge()
+{
+  const edge_index new_edge = p_current_node->first_edge + p_current_node->n_expanded;
+  auto best_val = simulate_playout(new_edge);
+  m_tree.edges().avg_val[new_edge] = m_tree.edges().best_val[new_edge] = best_val;
+  ++p_current_node->n_expanded;
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::expand_next_edge(
+    StateT& child)
+{
+  const edge_index new_edge = p_current_node->first_edge + p_current_node->n_expanded;
+  auto best_val = simulate_playout(new_edge, child);
+  m_tree.edges().avg_val[new_edge] = m_tree.edges().best_val[new_edge] = best_val;
+  ++p_current_node->n_expanded;
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+bool Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::can_widen(
+    node_pointer node)
+{
+  if (expansion_strategy != ExpansionStrategy::progressive || node->fully_expanded())
+    return false;
+
+  const auto expanded = m_tree.expanded(node);
+  return node->n_expanded
+             < widening_constant * std::pow(node->n_visits, widening_exponent)
+         || std::all_of(expanded.subtree_completed,
+                        expanded.subtree_completed + expanded.size,
+                        [](const auto completed) { return completed; });
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::backpropagate()
 {
   using BackpropagationStrategy::avg_best_value;
   using BackpropagationStrategy::avg_value;
   using BackpropagationStrategy::best_value;
 
-  auto cmp_best_value = [](const auto& a, const auto& b) {
-    return a.best_val < b.best_val;
-  };
-
-  reward_type value_to_propagate = [&]() {
-    if (p_current_node->children.empty())
+  reward_type value_to_propagate = [&]() -> reward_type {
+    if (p_current_node->n_children == 0)
     {
+      // The current path is a complete line.
+      record_line(m_path_len, m_path_val + evaluate_terminal());
       return evaluate_terminal();
     }
-    // BackpropagationStrategy::best_value
-    if (backpropagation_strategy == best_value)
+    const auto expanded = m_tree.expanded(p_current_node);
+    // BackpropagationStrategy::best_value, or the exact value of a solved node
+    if (backpropagation_strategy == best_value
+        || m_tree.is_solved(p_current_node))
     {
-      return std::max_element(p_current_node->children.begin(),
-                              p_current_node->children.end(),
-                              cmp_best_value)
-          ->best_val;
+      return *std::max_element(expanded.best_val, expanded.best_val + expanded.size);
     }
     // BackpropagationStrategy::avg_value and
     // BackpropagationStrategy::avg_best_value
-    auto get_value = [&](const auto& edge) {
-      return backpropagation_strategy == avg_value ? edge.avg_val
-                                                   : edge.best_val;
-    };
-    double total = std::transform_reduce(p_current_node->children.begin(),
-                                         p_current_node->children.end(),
-                                         0,
-                                         std::plus<double>(),
-                                         get_value);
-
-    return total / p_current_node->children.size();
+    const auto* values = backpropagation_strategy == avg_value ? expanded.avg_val
+                                                               : expanded.best_val;
+    double total = std::accumulate(values, values + expanded.size, 0.0);
+
+    return total / expanded.size;
   }();
 
   m_tree.backpropagate(value_to_propagate);
@@ -234,22 +413,58 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::traverse_edge(
-    edge_pointer edge)
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::traverse_edge(
+    edge_index edge)
 {
-  m_state.apply_action(edge->action);
-  p_current_node = m_tree.get_node(m_state.key());
-  m_tree.traversal_push(edge);
+  const ActionT& action = m_tree.action(edge);
+  const reward_type reward = evaluate(action);
+  m_state.apply_action(action);
+  p_current_node = m_tree.get_node(node_key(m_state));
+  m_tree.traversal_push(edge, p_current_node, reward);
+  if (m_path_len == m_path.size())
+    grow_buffers();
+  m_path[m_path_len++] = action;
+  m_path_val += reward;
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::ActionSequence
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::best_sequence(
+    ActionSelection method)
+{
+  const size_t n_done = m_actions_done.size();
+  best_traversal(method);
+
+  // The state is now at the end of the traversal.
+  reward_type traversal_val =
+      std::transform_reduce(m_actions_done.begin() + n_done,
+                            m_actions_done.end(),
+                            evaluate_terminal(),
+                            std::plus<reward_type>(),
+                            [&](const auto& action) { return evaluate(action); });
+
+  if (m_best_line_len > 0 && m_best_line_val > traversal_val)
+  {
+    m_actions_done.resize(n_done);
+    m_actions_done.insert(m_actions_done.end(),
+                          m_best_line.begin(),
+                          m_best_line.begin() + m_best_line_len);
+  }
+  return m_actions_done;
 }
 
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::ActionSequence
-Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::best_traversal(
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::ActionSequence
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::best_traversal(
     ActionSelection method)
 {
   if (m_state != m_root_state)
@@ -257,12 +472,15 @@ Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::best_traversal(
     return_to_root();
   }
 
-  edge_pointer p_nex_edge;
-  while (p_current_node->n_visits > 0 && p_current_node->children.size() > 0)
+  edge_index nex_edge;
+  while (p_current_node->n_visits > 0 && p_current_node->n_expanded > 0)
   {
-    p_nex_edge = get_best_edge(method);
-    traverse_edge(p_nex_edge);
-    m_actions_done.push_back(p_nex_edge->action);
+    // The values below a solved node are exact, so simply follow the best one.
+    nex_edge = get_best_edge(m_tree.is_solved(p_current_node)
+                                 ? ActionSelection::by_best_value
+                                 : method);
+    traverse_edge(nex_edge);
+    m_actions_done.push_back(m_tree.action(nex_edge));
   }
 
   if (p_current_node->n_visits > 0)
@@ -284,24 +502,43 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-inline void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::return_to_root()
+         size_t INITIAL_DEPTH>
+inline void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::return_to_root()
 {
   p_current_node = m_tree.get_root();
   m_state = m_root_state;
+  m_path_len = 0;
+  m_path_val = 0.0;
 }
 
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::apply_root_action(
-    const edge_type& edge)
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::apply_root_action(
+    const ActionT& action)
 {
-  m_root_state.apply_action(edge.action);
-  m_actions_done.push_back(edge.action);
-  m_tree.set_root(m_root_state.key());
+  m_root_state.apply_action(action);
+  m_actions_done.push_back(action);
+
+  if (m_best_line_len > 0 && m_best_line[0] == action)
+  {
+    std::copy(m_best_line.begin() + 1,
+              m_best_line.begin() + m_best_line_len,
+              m_best_line.begin());
+    --m_best_line_len;
+    m_best_line_val -= evaluate(action);
+  }
+  else
+  {
+    m_best_line_len = 0;
+    m_best_line_val = std::numeric_limits<reward_type>::lowest();
+  }
+  // The actions played so far are out of reach: every action is canonical at the root.
+  if constexpr (policies::HasCanonicalActions<StateT, ActionT>)
+    m_root_state.clear_last_action();
+  m_tree.set_root(node_key(m_root_state));
   return_to_root();
 }
 
@@ -309,10 +546,12 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-bool Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::computation_resources()
+         size_t INITIAL_DEPTH>
+bool Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::computation_resources()
 {
-  bool time_ok = max_time > 0 ? timer::time_elapsed() < max_time : true;
+  if (p_stop_flag && p_stop_flag->load(std::memory_order_relaxed))
+    return false;
+  bool time_ok = max_time > 0 ? time_elapsed() < max_time : true;
   bool iterations_ok =
       max_iterations > 0 ? iteration_cnt < max_iterations : true;
   return time_ok && iterations_ok;
@@ -322,20 +561,34 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::init_counters()
+         size_t INITIAL_DEPTH>
+inline std::chrono::milliseconds::rep
+Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::time_elapsed() const
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - m_start_time)
+      .count();
+}
+
+template<typename StateT,
+         typename ActionT,
+         typename UCB_Functor,
+         typename Playout_Functor,
+         size_t INITIAL_DEPTH>
+void Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::init_counters()
 {
   iteration_cnt = 0;
-  timer::start = std::chrono::steady_clock::now();
+  m_stats = SearchStats{};
+  m_start_time = std::chrono::steady_clock::now();
 }
 
 template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::reward_type
-inline Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::evaluate(const ActionT& action)
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::reward_type
+inline Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::evaluate(const ActionT& action)
 {
   return m_state.evaluate(action);
 }
@@ -344,9 +597,9 @@ template<typename StateT,
          typename ActionT,
          typename UCB_Functor,
          typename Playout_Functor,
-         size_t MAX_DEPTH>
-typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::reward_type
-inline Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, MAX_DEPTH>::evaluate_terminal()
+         size_t INITIAL_DEPTH>
+typename Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::reward_type
+inline Mcts<StateT, ActionT, UCB_Functor, Playout_Functor, INITIAL_DEPTH>::evaluate_terminal()
 {
   return m_state.evaluate_terminal();
 }
@@ -1,38 +1,202 @@
 #ifndef __MCTSTREE_H_
 #define __MCTSTREE_H_
 
-#include <unordered_map>
+#include "policies.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace mcts {
 
-template<typename StateT, typename ActionT, size_t MAX_DEPTH>
+/**
+ * Hash table from the keys of the states to their nodes, with open addressing and
+ * linear probing.
+ *
+ * The nodes are allocated by blocks which never move, so that pointers to them stay
+ * valid when the table grows. After `reserve(n)`, inserting up to n nodes does not
+ * allocate at all.
+ */
+template<typename Key, typename Node>
+class NodeTable
+{
+ public:
+  static constexpr size_t block_size = 1 << 12;
+
+  NodeTable() { rehash(min_slots); }
+
+  /**
+   * @Return The node of the key, value-initialized if it was just inserted, and
+   * whether it was.
+   */
+  std::pair<Node*, bool> insert(const Key key)
+  {
+    if (2 * (m_size + 1) > m_slots.size())
+      rehash(2 * m_slots.size());
+
+    size_t ndx = slot_of(key);
+    for (; m_slots[ndx].node != nullptr; ndx = (ndx + 1) & m_mask)
+    {
+      if (m_slots[ndx].key == key)
+        return {m_slots[ndx].node, false};
+    }
+    Node* node = new_node();
+    m_slots[ndx] = Slot{key, node};
+    ++m_size;
+    return {node, true};
+  }
+
+  /**
+   * Allocate the nodes and slots for `n` nodes up front.
+   */
+  void reserve(size_t n)
+  {
+    size_t n_slots = m_slots.size();
+    while (n_slots < 2 * n)
+      n_slots *= 2;
+    if (n_slots > m_slots.size())
+      rehash(n_slots);
+
+    const size_t n_blocks = (n + block_size - 1) / block_size;
+    m_blocks.reserve(n_blocks);
+    while (m_blocks.size() < n_blocks)
+      m_blocks.push_back(std::make_unique<Node[]>(block_size));
+  }
+
+  size_t size() const { return m_size; }
+  /** The memory held by the table, in bytes. */
+  size_t bytes() const
+  {
+    return m_blocks.size() * block_size * sizeof(Node) + m_slots.size() * sizeof(Slot)
+           + m_blocks.capacity() * sizeof(typename Blocks::value_type);
+  }
+
+ private:
+  struct Slot
+  {
+    Key key;
+    Node* node;
+  };
+  using Blocks = std::vector<std::unique_ptr<Node[]>>;
+  static constexpr size_t min_slots = 1 << 6;
+
+  std::vector<Slot> m_slots;
+  Blocks m_blocks;
+  size_t m_size = 0;
+  size_t m_mask = 0;
+  int m_shift = 0;
+
+  /** Fibonacci hashing: the high bits of the product are well mixed. */
+  size_t slot_of(const Key key) const
+  {
+    return (uint64_t(key) * 0x9E3779B97F4A7C15ull) >> m_shift;
+  }
+
+  Node* new_node()
+  {
+    const size_t block = m_size / block_size;
+    if (block == m_blocks.size())
+      m_blocks.push_back(std::make_unique<Node[]>(block_size));
+    Node* ret = &m_blocks[block][m_size % block_size];
+    *ret = Node{};
+    return ret;
+  }
+
+  /** The number of slots must be a power of two. */
+  void rehash(size_t n_slots)
+  {
+    std::vector<Slot> old_slots(n_slots, Slot{Key{}, nullptr});
+    old_slots.swap(m_slots);
+    m_mask = n_slots - 1;
+    m_shift = 64 - std::countr_zero(n_slots);
+
+    for (const Slot& slot : old_slots)
+    {
+      if (slot.node == nullptr)
+        continue;
+      size_t ndx = slot_of(slot.key);
+      while (m_slots[ndx].node != nullptr)
+        ndx = (ndx + 1) & m_mask;
+      m_slots[ndx] = slot;
+    }
+  }
+};
+
+template<typename StateT, typename ActionT, size_t INITIAL_DEPTH>
 class MctsTree
 {
  public:
   struct Node;
-  struct Edge;
   using node_pointer = Node*;
-  using edge_pointer = Edge*;
-  using ChildrenContainer = std::vector<Edge>;
+  using edge_index = uint32_t;
   using key_type = typename StateT::key_type;
   using reward_type = typename StateT::reward_type;
+  /** The edge statistics are kept in single precision to fit more edges per cache line. */
+  using stat_type = float;
+  using EdgeBatch = policies::EdgeBatch<ActionT, stat_type>;
+  /** A copy of the data of one edge. */
+  using Edge = typename EdgeBatch::Edge;
+
+  /**
+   * The edges of a node are the indices [first_edge, first_edge + n_children) of the
+   * tree's edge arrays. Only the first `n_expanded` of them are part of the tree.
+   */
   struct Node
   {
     int n_visits;
-    ChildrenContainer children;
+    edge_index first_edge;
+    edge_index n_children;
+    edge_index n_expanded;
+
+    bool fully_expanded() const { return n_expanded == n_children; }
   };
-  struct Edge
+
+  /**
+   * The edges are stored as a structure of arrays, where the children of a node
+   * are contiguous so that the selection can process them in batches.
+   */
+  struct Edges
   {
-    ActionT action;
-    reward_type avg_val;
-    reward_type best_val;
-    int n_visits;
-    bool subtree_completed;
+    std::vector<ActionT> action;
+    std::vector<stat_type> avg_val;
+    std::vector<stat_type> best_val;
+    std::vector<int> n_visits;
+    /** Set once the subtree below is fully explored: `best_val` is then exact. */
+    std::vector<uint8_t> subtree_completed;
+
+    edge_index size() const { return action.size(); }
+    static constexpr size_t bytes_per_edge = sizeof(ActionT) + 2 * sizeof(stat_type)
+                                             + sizeof(int) + sizeof(uint8_t);
+    void reserve(size_t n)
+    {
+      action.reserve(n);
+      avg_val.reserve(n);
+      best_val.reserve(n);
+      n_visits.reserve(n);
+      subtree_completed.reserve(n);
+    }
+    void push_back(const ActionT& _action)
+    {
+      action.push_back(_action);
+      avg_val.push_back(0.0);
+      best_val.push_back(0.0);
+      n_visits.push_back(0);
+      subtree_completed.push_back(false);
+    }
   };
 
   MctsTree(key_type key)
-    : m_table(), m_edge_stack{}, m_depth{0}, p_root(get_node(key))
+    : m_table(),
+      m_edges(),
+      m_edge_stack(INITIAL_DEPTH),
+      m_node_stack(INITIAL_DEPTH),
+      m_reward_stack(INITIAL_DEPTH),
+      m_depth{0},
+      p_root(get_node(key))
   {
   }
 
@@ -46,48 +210,173 @@ class MctsTree
     m_depth = 0;
     return p_root;
   }
+  const Node& root() const { return *p_root; }
   node_pointer get_node(const key_type key)
   {
-    auto [node_it, inserted] = m_table.insert(std::pair{key, Node{}});
-    return &(node_it->second);
+    return m_table.insert(key).first;
+  }
+  /**
+   * Allocate the memory for that many nodes and edges, so that the tree grows up
+   * to that size without allocating.
+   */
+  void reserve(size_t n_nodes, size_t n_edges)
+  {
+    m_table.reserve(n_nodes);
+    m_edges.reserve(n_edges);
   }
-  void traversal_push(edge_pointer edge)
+  /**
+   * Append the edges of the given actions to the node.
+   */
+  template<typename ActionContainer>
+  void add_children(node_pointer node, const ActionContainer& actions)
   {
+    node->first_edge = m_edges.size();
+    node->n_children = actions.size();
+    for (const auto& action : actions)
+      m_edges.push_back(action);
+  }
+
+  Edges& edges() { return m_edges; }
+  const ActionT& action(edge_index ndx) const { return m_edges.action[ndx]; }
+  Edge edge(edge_index ndx) const { return batch(ndx, 1)[0]; }
+
+  /**
+   * The expanded children of the node, in a form suitable for the UCB functors.
+   */
+  EdgeBatch expanded(const node_pointer node) const
+  {
+    return batch(node->first_edge, node->n_expanded);
+  }
+
+  /**
+   * Record the traversal of `edge`, leading to `node` and yielding `reward`.
+   */
+  void traversal_push(edge_index edge, node_pointer node, reward_type reward)
+  {
+    if (m_depth == m_edge_stack.size())
+    {
+      m_edge_stack.resize(2 * m_depth);
+      m_node_stack.resize(2 * m_depth);
+      m_reward_stack.resize(2 * m_depth);
+    }
     m_edge_stack[m_depth] = edge;
+    m_node_stack[m_depth] = node;
+    m_reward_stack[m_depth] = reward;
     ++m_depth;
   }
-  void backpropagate(reward_type reward)
+  /**
+   * Update the edges of the traversal stack from the leaf upwards. Each edge
+   * sees its own reward plus the value of what lies below it.
+   *
+   * If the leaf is solved, the proof moves up the stack for as long as all the
+   * siblings of the traversed edge are completed too.
+   */
+  void backpropagate(reward_type value)
   {
-    std::for_each(m_edge_stack.begin(),
-                  m_edge_stack.begin() + m_depth,
-                  update_stats(reward));
+    node_pointer leaf = m_depth > 0 ? m_node_stack[m_depth - 1] : p_root;
+    bool solved = is_solved(leaf);
+    reward_type exact_val = leaf->n_expanded == 0 ? value : best_child_value(leaf);
+
+    for (auto depth = m_depth; depth-- > 0;)
+    {
+      const edge_index edge = m_edge_stack[depth];
+      value += m_reward_stack[depth];
+      update_stats(edge, value);
+
+      if (!solved)
+        continue;
+
+      exact_val += m_reward_stack[depth];
+      m_edges.subtree_completed[edge] = true;
+      m_edges.avg_val[edge] = m_edges.best_val[edge] = exact_val;
+
+      node_pointer parent = depth > 0 ? m_node_stack[depth - 1] : p_root;
+      solved = is_solved(parent);
+      if (solved)
+        exact_val = best_child_value(parent);
+    }
+  }
+  /**
+   * A node is solved when it has been fully expanded and all its edges are completed
+   * (in particular, when it is terminal).
+   */
+  bool is_solved(const node_pointer node) const
+  {
+    return node->n_visits > 0 && node->fully_expanded()
+           && std::all_of(m_edges.subtree_completed.begin() + node->first_edge,
+                          m_edges.subtree_completed.begin() + node->first_edge
+                              + node->n_children,
+                          [](const auto completed) { return completed; });
+  }
+  bool root_solved() const
+  {
+    return is_solved(p_root);
   }
   size_t size()
   {
     return m_table.size();
   }
+  size_t n_edges() const { return m_edges.size(); }
+
+  /**
+   * The memory held by the tree, counting the allocated capacity of the edge
+   * arrays and of the node table.
+   */
+  struct MemoryUsage
+  {
+    size_t n_nodes;
+    size_t n_edges;
+    size_t node_bytes;
+    size_t edge_bytes;
+
+    double bytes_per_node() const { return n_nodes ? double(node_bytes) / n_nodes : 0.0; }
+    double bytes_per_edge() const { return n_edges ? double(edge_bytes) / n_edges : 0.0; }
+    size_t total_bytes() const { return node_bytes + edge_bytes; }
+  };
+  MemoryUsage memory_usage() const
+  {
+    return MemoryUsage{
+        .n_nodes = m_table.size(),
+        .n_edges = m_edges.size(),
+        .node_bytes = m_table.bytes(),
+        .edge_bytes = m_edges.action.capacity() * Edges::bytes_per_edge};
+  }
 
  private:
-  using LookupTable = typename std::unordered_map<key_type, Node>;
-  using TraversalStack = std::array<edge_pointer, MAX_DEPTH>;
+  using LookupTable = NodeTable<key_type, Node>;
 
   LookupTable m_table;
-  TraversalStack m_edge_stack;
+  Edges m_edges;
+  // The traversal stacks start INITIAL_DEPTH deep and grow with the deepest traversal.
+  std::vector<edge_index> m_edge_stack;
+  std::vector<node_pointer> m_node_stack;
+  std::vector<reward_type> m_reward_stack;
   size_t m_depth;
   Node* p_root;
 
-  struct update_stats
+  EdgeBatch batch(edge_index first, edge_index n) const
   {
-    reward_type val;
-    update_stats(reward_type _val) : val(_val) {}
-    void operator()(edge_pointer edge)
-    {
-      ++edge->n_visits;
-      edge->avg_val += (val - edge->avg_val) / (edge->n_visits);
-      edge->best_val = std::max(
-          edge->best_val, val); // > edge->best_val ? val : edge->best_val;
-    }
-  };
+    return EdgeBatch{.action = m_edges.action.data() + first,
+                     .avg_val = m_edges.avg_val.data() + first,
+                     .best_val = m_edges.best_val.data() + first,
+                     .n_visits = m_edges.n_visits.data() + first,
+                     .subtree_completed = m_edges.subtree_completed.data() + first,
+                     .size = n};
+  }
+
+  stat_type best_child_value(const node_pointer node) const
+  {
+    return *std::max_element(m_edges.best_val.begin() + node->first_edge,
+                             m_edges.best_val.begin() + node->first_edge
+                                 + node->n_expanded);
+  }
+
+  void update_stats(const edge_index edge, const reward_type val)
+  {
+    int n_visits = ++m_edges.n_visits[edge];
+    m_edges.avg_val[edge] += (val - m_edges.avg_val[edge]) / n_visits;
+    m_edges.best_val[edge] = std::max(m_edges.best_val[edge], stat_type(val));
+  }
 };
 
 } // namespace mcts
@@ -0,0 +1,114 @@
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+namespace {
+
+constexpr const char* EVENT_NAMES[N_EVENTS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"};
+
+#if defined(__linux__)
+constexpr uint64_t EVENT_CONFIGS[N_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                              PERF_COUNT_HW_INSTRUCTIONS,
+                                              PERF_COUNT_HW_CACHE_MISSES,
+                                              PERF_COUNT_HW_BRANCH_MISSES};
+
+/**
+ * Count the event for the calling thread, in user space only.
+ *
+ * @Return The file descriptor of the event, or -1 (with errno set).
+ */
+int open_event(uint64_t config, int group_fd)
+{
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group_fd < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+
+} // namespace
+
+ThreadCounters& ThreadCounters::get()
+{
+  thread_local ThreadCounters counters{};
+  return counters;
+}
+
+ThreadCounters::ThreadCounters()
+{
+  m_fds.fill(-1);
+  m_slot.fill(-1);
+
+#if defined(__linux__)
+  for (int e = 0; e < N_EVENTS; ++e)
+  {
+    m_fds[e] = open_event(EVENT_CONFIGS[e], m_leader);
+    if (m_fds[e] < 0)
+    {
+      m_status += std::string(EVENT_NAMES[e]) + ": " + std::strerror(errno) + "; ";
+      continue;
+    }
+    if (m_leader < 0)
+      m_leader = m_fds[e];
+    m_slot[e] = m_n_open++;
+  }
+
+  if (m_leader >= 0)
+  {
+    ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#else
+  m_status = "hardware counters are only supported on Linux";
+#endif
+}
+
+ThreadCounters::~ThreadCounters()
+{
+#if defined(__linux__)
+  for (int fd : m_fds)
+  {
+    if (fd >= 0)
+      close(fd);
+  }
+#endif
+}
+
+Counts ThreadCounters::read() const
+{
+  Counts ret{};
+#if defined(__linux__)
+  if (m_leader < 0)
+    return ret;
+
+  // PERF_FORMAT_GROUP: the number of events, then their values in opening order.
+  std::array<uint64_t, N_EVENTS + 1> buf{};
+  if (::read(m_leader, buf.data(), sizeof(buf)) < 0)
+    return ret;
+
+  for (int e = 0; e < N_EVENTS; ++e)
+  {
+    if (m_slot[e] >= 0)
+      ret.values[e] = buf[1 + m_slot[e]];
+  }
+#endif
+  return ret;
+}
+
+} // namespace perf
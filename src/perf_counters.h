@@ -0,0 +1,88 @@
+#ifndef __PERF_COUNTERS_H_
+#define __PERF_COUNTERS_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * Hardware performance counters of the calling thread, read with Linux's
+ * perf_event_open. Used by the instrumentation when compiled with
+ * SG_PERF_COUNTERS (see instrument.h).
+ *
+ * When the counters cannot be opened (other OS, no PMU in a virtual machine,
+ * perf_event_paranoid too high in a container, ...), `available()` is false and
+ * every read returns zeros.
+ */
+namespace perf {
+
+enum Event
+{
+  cycles,
+  instructions,
+  cache_misses,
+  branch_misses,
+  N_EVENTS
+};
+
+/** The values of the events, zero for the ones which could not be opened. */
+struct Counts
+{
+  std::array<uint64_t, N_EVENTS> values{};
+
+  uint64_t operator[](Event e) const { return values[e]; }
+  Counts& operator+=(const Counts& other)
+  {
+    for (int e = 0; e < N_EVENTS; ++e)
+      values[e] += other.values[e];
+    return *this;
+  }
+  friend Counts operator-(Counts a, const Counts& b)
+  {
+    for (int e = 0; e < N_EVENTS; ++e)
+      a.values[e] -= b.values[e];
+    return a;
+  }
+  bool empty() const { return values == std::array<uint64_t, N_EVENTS>{}; }
+  double ipc() const
+  {
+    return values[cycles] ? double(values[instructions]) / values[cycles] : 0.0;
+  }
+};
+
+class ThreadCounters
+{
+ public:
+  /** The counters of the calling thread, opened (and started) on first use. */
+  static ThreadCounters& get();
+
+  ~ThreadCounters();
+  ThreadCounters(const ThreadCounters&) = delete;
+  ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+  /** True if at least one of the events could be opened. */
+  bool available() const { return m_leader >= 0; }
+  bool available(Event e) const { return m_slot[e] >= 0; }
+  /** Why some events are missing, empty if they were all opened. */
+  const std::string& status() const { return m_status; }
+
+  /**
+   * The values of the events since the counters were opened, with a single
+   * read() of the whole group.
+   */
+  Counts read() const;
+
+ private:
+  ThreadCounters();
+
+  int m_leader = -1;
+  std::array<int, N_EVENTS> m_fds;
+  /** The position of each event in the group, -1 if it is missing. */
+  std::array<int, N_EVENTS> m_slot;
+  int m_n_open = 0;
+  std::string m_status;
+};
+
+} // namespace perf
+
+#endif
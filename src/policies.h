@@ -1,16 +1,170 @@
 #ifndef __MCTS_POLICIES_H_
 #define __MCTS_POLICIES_H_
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace policies {
 
+/**
+ * The states able to build all their children in one pass, along with their valid
+ * actions, as `State::generate_children` does.
+ */
+template<typename StateT, typename ActionT>
+concept GeneratesChildren = requires(const StateT& state,
+                                     std::vector<ActionT>& actions,
+                                     std::vector<StateT>& children) {
+  state.generate_children(actions, children);
+};
+
+/**
+ * The states able to leave out the actions which commute with the last one applied,
+ * as `State::canonical_actions_data` does. Those must also key their nodes with
+ * `canonical_key`, since their actions depend on more than the grid.
+ */
+template<typename StateT, typename ActionT>
+concept HasCanonicalActions = requires(StateT& state,
+                                       std::vector<ActionT>& actions,
+                                       std::vector<StateT>& children) {
+  state.canonical_actions_data(actions);
+  state.generate_canonical_children(actions, children);
+  state.clear_last_action();
+  state.canonical_key();
+};
+
+/**
+ * The children of a node as seen by the UCB functors: each statistic is
+ * stored in its own contiguous array.
+ */
+template<typename ActionT, typename Real>
+struct EdgeBatch
+{
+  /** A copy of the statistics of one edge. */
+  struct Edge
+  {
+    ActionT action;
+    Real avg_val;
+    Real best_val;
+    int n_visits;
+    bool subtree_completed;
+  };
+
+  const ActionT* action;
+  const Real* avg_val;
+  const Real* best_val;
+  const int* n_visits;
+  const uint8_t* subtree_completed;
+  size_t size;
+
+  Edge operator[](size_t i) const
+  {
+    return Edge{action[i], avg_val[i], best_val[i], n_visits[i], bool(subtree_completed[i])};
+  }
+};
+
+/**
+ * Return the index maximizing `avg_val[i] + expl_cst * sqrt(log_n_parent / (n_visits[i] + 1))`
+ * amongst the edges which are not completed, or `n` if they all are. Ties go to the
+ * lowest index.
+ *
+ * @Note The scores are computed in single precision, four edges at a time.
+ */
+inline size_t ucb_argmax(const float* avg_val,
+                         const int* n_visits,
+                         const uint8_t* completed,
+                         size_t n,
+                         double expl_cst,
+                         double log_n_parent)
+{
+  constexpr float lowest = std::numeric_limits<float>::lowest();
+  const float cst_f = expl_cst;
+  const float log_n_f = log_n_parent;
+  size_t ret = n;
+  float best = lowest;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 cst = _mm_set1_ps(cst_f);
+  const __m128 log_n = _mm_set1_ps(log_n_f);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  const __m128 low = _mm_set1_ps(lowest);
+  __m128 best_v = low;
+  __m128 best_ndx = _mm_set1_ps(-1.0f);
+  __m128 ndx = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 visits = _mm_cvtepi32_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(n_visits + i)));
+    __m128 score = _mm_add_ps(
+        _mm_loadu_ps(avg_val + i),
+        _mm_mul_ps(cst, _mm_sqrt_ps(_mm_div_ps(log_n, _mm_add_ps(visits, one)))));
+    // Widen the four completion flags to lane masks.
+    int32_t flags;
+    std::memcpy(&flags, completed + i, sizeof(flags));
+    __m128i bytes = _mm_cvtsi32_si128(flags);
+    bytes = _mm_unpacklo_epi8(bytes, bytes);
+    bytes = _mm_unpacklo_epi16(bytes, bytes);
+    __m128 done = _mm_castsi128_ps(
+        _mm_cmpgt_epi32(_mm_and_si128(bytes, _mm_set1_epi32(0xff)), _mm_setzero_si128()));
+
+    __m128 better = _mm_andnot_ps(done, _mm_cmpgt_ps(score, best_v));
+    best_v = _mm_or_ps(_mm_and_ps(better, score), _mm_andnot_ps(better, best_v));
+    best_ndx = _mm_or_ps(_mm_and_ps(better, ndx), _mm_andnot_ps(better, best_ndx));
+    ndx = _mm_add_ps(ndx, four);
+  }
+
+  // Reduce the lanes: each one holds the first maximum of its residue class.
+  alignas(16) float lanes_v[4], lanes_ndx[4];
+  _mm_store_ps(lanes_v, best_v);
+  _mm_store_ps(lanes_ndx, best_ndx);
+  for (int lane = 0; lane < 4; ++lane)
+  {
+    if (lanes_ndx[lane] < 0.0f)
+      continue;
+    size_t lane_ndx = lanes_ndx[lane];
+    if (ret == n || lanes_v[lane] > best || (lanes_v[lane] == best && lane_ndx < ret))
+    {
+      best = lanes_v[lane];
+      ret = lane_ndx;
+    }
+  }
+#endif
+
+  for (; i < n; ++i)
+  {
+    if (completed[i])
+      continue;
+    float score = avg_val[i] + cst_f * std::sqrt(log_n_f / (n_visits[i] + 1.0f));
+    if (ret == n || score > best)
+    {
+      best = score;
+      ret = i;
+    }
+  }
+  return ret;
+}
+
 /**
  * A UCB functor is used in the MCTS algorithm to select which edge to traverse
  * when exploring the state/action tree. Until we land on an unexplored node,
  * we choose the edge maximizing the functor's operator().
+ *
+ * A functor can also select directly over a whole EdgeBatch by implementing
+ * `select(expl_cst, n_parent_visits, batch)`, see `select_ucb`.
  */
 struct Default_UCB_Func
 {
@@ -21,8 +175,89 @@ struct Default_UCB_Func
              + expl_cst * sqrt(log(n_parent_visits) / (edge.n_visits + 1.0));
     };
   }
+
+  template<typename Batch>
+  size_t select(double expl_cst, unsigned int n_parent_visits, const Batch& batch)
+  {
+    return ucb_argmax(batch.avg_val,
+                      batch.n_visits,
+                      batch.subtree_completed,
+                      batch.size,
+                      expl_cst,
+                      std::log(n_parent_visits));
+  }
+};
+
+/**
+ * Remove the contribution from the log term after `N` visits of the parent, the
+ * search then only exploits the average values.
+ *
+ * @Note This really improves the run-time and average score!
+ */
+template<int N>
+struct TimeCutoff_UCB_Func
+{
+  auto operator()(double expl_cst, unsigned int n_parent_visits)
+  {
+    return [expl_cst, n_parent_visits]<typename EdgeT>(const EdgeT& edge) {
+      double ret =
+          (n_parent_visits < N
+               ? expl_cst * sqrt(log(n_parent_visits) / (edge.n_visits + 1.0))
+               : 0.00001);
+      return ret + edge.avg_val;
+    };
+  }
+
+  /** Past the cutoff, the exploration term is the same for all edges. */
+  template<typename Batch>
+  size_t select(double expl_cst, unsigned int n_parent_visits, const Batch& batch)
+  {
+    return ucb_argmax(batch.avg_val,
+                      batch.n_visits,
+                      batch.subtree_completed,
+                      batch.size,
+                      n_parent_visits < N ? expl_cst : 0.0,
+                      std::log(n_parent_visits));
+  }
 };
 
+/**
+ * Return the index of the edge of the batch maximizing the UCB functor, amongst the
+ * edges which are not completed.
+ *
+ * The functor's `select` method is used if it has one, otherwise its per-edge
+ * function is evaluated on each edge.
+ */
+template<typename UCB_Functor, typename Batch>
+size_t select_ucb(UCB_Functor& ucb_func,
+                  double expl_cst,
+                  unsigned int n_parent_visits,
+                  const Batch& batch)
+{
+  if constexpr (requires { ucb_func.select(expl_cst, n_parent_visits, batch); })
+  {
+    return ucb_func.select(expl_cst, n_parent_visits, batch);
+  }
+  else
+  {
+    auto ucb = ucb_func(expl_cst, n_parent_visits);
+    size_t ret = batch.size;
+    double best = std::numeric_limits<double>::lowest();
+    for (size_t i = 0; i < batch.size; ++i)
+    {
+      if (batch.subtree_completed[i])
+        continue;
+      double score = ucb(batch[i]);
+      if (ret == batch.size || score > best)
+      {
+        best = score;
+        ret = i;
+      }
+    }
+    return ret;
+  }
+}
+
 template<typename StateT, typename ActionT>
 struct Default_Playout_Func
 {
@@ -39,6 +274,295 @@ struct Default_Playout_Func
   StateT& state;
 };
 
+/**
+ * Applies a random action but tries to go for the color which has the least
+ * number of cells in the grid first.
+ *
+ * @Note StateT has to implement `color_counter()`, counting the cells of each
+ * color (the first one being the empty color), and `apply_random_action(color)`.
+ */
+template<typename StateT, typename ActionT>
+struct SmallColor_Playout_Func
+{
+  using Color = decltype(ActionT::color);
+
+  SmallColor_Playout_Func(StateT& _state) :
+    state(_state)
+  {
+  }
+
+  ActionT operator()()
+  {
+    const auto& colors = state.color_counter();
+    // Skip the empty color and the colors which are already cleared.
+    auto target_it = std::min_element(
+        colors.begin() + 1, colors.end(), [](const int a, const int b) {
+          return a != 0 && (b == 0 || a < b);
+        });
+    const Color target = Color(std::distance(colors.begin(), target_it));
+    return state.apply_random_action(target);
+  }
+
+  StateT& state;
+};
+
+/**
+ * Play actions with the `Base_Playout_Func` until the state gets small, then
+ * finish the playout with the best continuation found by an exhaustive search.
+ *
+ * The switch happens once the state has at most `CellThreshold` non-empty cells,
+ * or at most `ActionThreshold` valid actions (the latter requires generating the
+ * actions at every step, so it is disabled when set to 0). The search looks at most
+ * `MaxDepth` actions ahead, estimating the value of deeper states with one base
+ * playout, and its results are cached by key so that a given endgame is searched
+ * only once. A result is only reused where it looks at least as far ahead as the
+ * search would, so that the endgames within the horizon are solved exactly.
+ *
+ * @Note On top of the methods needed by Mcts, StateT has to implement `n_cells()`
+ * and `is_terminal()`.
+ *
+ * With `CanonicalOrder`, the search only tries the canonical actions of the states
+ * (see policies::HasCanonicalActions), so that two actions which commute are only
+ * tried in one order.
+ *
+ * @Note Once the cache and the action buffers of a thread are allocated, the
+ * playouts do not allocate anymore.
+ */
+template<typename StateT,
+         typename ActionT,
+         int CellThreshold = 20,
+         int ActionThreshold = 0,
+         int MaxDepth = 16,
+         typename Base_Playout_Func = Default_Playout_Func<StateT, ActionT>,
+         bool CanonicalOrder = false>
+struct Hybrid_Playout_Func
+{
+  static_assert(!CanonicalOrder || HasCanonicalActions<StateT, ActionT>);
+
+  using reward_type = typename StateT::reward_type;
+  using key_type = typename StateT::key_type;
+  using ActionVec = std::vector<ActionT>;
+  using StateVec = std::vector<StateT>;
+
+  /** The horizon of a search which only reached terminal states. */
+  static constexpr int EXACT = MaxDepth + 1;
+
+  /** The value of a state and the action to play from it. */
+  struct Entry
+  {
+    reward_type value;
+    ActionT action;
+    /** How many actions ahead the search looked, EXACT if it saw the end of the game. */
+    int horizon{EXACT};
+  };
+
+  /**
+   * Direct-mapped table of the entries: a new entry replaces the one which was in
+   * its slot, so the cache has a fixed size.
+   */
+  class Cache
+  {
+   public:
+    static constexpr size_t size = 1 << 18;
+
+    Cache() : m_slots(size) {}
+
+    /** The entry of `key`, if it was searched at least `horizon` actions ahead. */
+    const Entry* find(const key_type key, const int horizon) const
+    {
+      const Slot& slot = m_slots[slot_of(key)];
+      return slot.used && slot.key == key && slot.entry.horizon >= horizon ? &slot.entry
+                                                                           : nullptr;
+    }
+    void insert(const key_type key, const Entry& entry)
+    {
+      m_slots[slot_of(key)] = Slot{key, entry, true};
+    }
+
+   private:
+    struct Slot
+    {
+      key_type key;
+      Entry entry;
+      bool used;
+    };
+    std::vector<Slot> m_slots;
+
+    static size_t slot_of(const key_type key)
+    {
+      return (uint64_t(key) * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero(size));
+    }
+  };
+
+  Hybrid_Playout_Func(StateT& _state) :
+    state(_state),
+    base_playout(_state),
+    solving(false)
+  {
+  }
+
+  ActionT operator()()
+  {
+    solving = solving || below_threshold();
+    if (!solving)
+      return base_playout();
+
+    // The search caches the key of the state it starts from, so it gets a copy. The
+    // actions played so far are out of reach: every action is canonical there.
+    // If the search stopped at its horizon here, there is no action to follow.
+    StateT root = state;
+    if constexpr (CanonicalOrder)
+      root.clear_last_action();
+    ActionT action = solve(root, 0).action;
+    if (state.is_trivial(action))
+      return state.is_terminal() ? action : base_playout();
+
+    state.apply_action(action);
+    return action;
+  }
+
+  bool below_threshold()
+  {
+    if (state.n_cells() <= CellThreshold)
+      return true;
+    if (ActionThreshold == 0)
+      return false;
+    ActionVec& actions = action_buffer(0);
+    state.valid_actions_data(actions);
+    return actions.size() <= ActionThreshold;
+  }
+
+  /**
+   * Return the best value reachable from `_state` along with the first action
+   * to get it, searching at most `MaxDepth - depth` actions ahead.
+   */
+  static Entry solve(StateT& _state, int depth)
+  {
+    key_type key;
+    if constexpr (CanonicalOrder)
+      key = _state.canonical_key();
+    else
+      key = _state.key();
+    if (const Entry* entry = cache().find(key, MaxDepth - depth))
+      return *entry;
+
+    Entry ret{_state.evaluate_terminal(), ActionT{}};
+    ActionVec& actions = action_buffer(depth);
+
+    // Past the horizon, settle for an estimate and leave the action trivial.
+    if (depth == MaxDepth)
+    {
+      _state.valid_actions_data(actions);
+      if (!actions.empty())
+      {
+        ret.value = estimate(_state);
+        ret.horizon = 0;
+      }
+    }
+    else if constexpr (GeneratesChildren<StateT, ActionT>)
+    {
+      // Every child is searched, so they are all built along with the actions.
+      StateVec& children = child_buffer(depth);
+      if constexpr (CanonicalOrder)
+        _state.generate_canonical_children(actions, children);
+      else
+        _state.generate_children(actions, children);
+      for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+        search_child(_state, actions[ndx], children[ndx], depth, ret);
+    }
+    else
+    {
+      if constexpr (CanonicalOrder)
+        _state.canonical_actions_data(actions);
+      else
+        _state.valid_actions_data(actions);
+      for (const ActionT& action : actions)
+      {
+        StateT child = _state;
+        child.apply_action(action);
+        search_child(_state, action, child, depth, ret);
+      }
+    }
+
+    cache().insert(key, ret);
+    return ret;
+  }
+
+  /**
+   * Keep in `best` the value and the action of `action` if it beats it, and the
+   * horizon of the shortest search among the children.
+   */
+  static void search_child(
+      const StateT& _state, const ActionT& action, StateT& child, int depth, Entry& best)
+  {
+    const Entry entry = solve(child, depth + 1);
+    reward_type value = _state.evaluate(action) + entry.value;
+    if (_state.is_trivial(best.action) || value > best.value)
+    {
+      best.value = value;
+      best.action = action;
+    }
+    best.horizon = std::min(best.horizon, std::min(entry.horizon + 1, EXACT));
+  }
+
+  /** The score of one playout of the base policy. */
+  static reward_type estimate(StateT _state)
+  {
+    Base_Playout_Func Playout_Func(_state);
+    reward_type score = 0.0;
+    ActionT action = Playout_Func();
+    while (!_state.is_trivial(action))
+    {
+      score += _state.evaluate(action);
+      action = Playout_Func();
+    }
+    return score + _state.evaluate_terminal();
+  }
+
+  /** One cache per thread, shared by all the playouts. */
+  static Cache& cache()
+  {
+    static thread_local Cache _cache{};
+    return _cache;
+  }
+
+  /**
+   * The valid actions of the states searched at each depth, for each thread.
+   *
+   * @Note A state with n cells has at most n / 2 valid actions, and one with
+   * `ActionThreshold` valid actions rarely gets more after a move.
+   */
+  static ActionVec& action_buffer(int depth)
+  {
+    static thread_local std::array<ActionVec, MaxDepth + 1> _buffers = []() {
+      std::array<ActionVec, MaxDepth + 1> ret{};
+      for (auto& buffer : ret)
+        buffer.reserve(CellThreshold / 2 + ActionThreshold + 1);
+      return ret;
+    }();
+    return _buffers[depth];
+  }
+
+  /**
+   * The children of the states searched at each depth but the last, for each thread,
+   * reserved as the action buffers.
+   */
+  static StateVec& child_buffer(int depth)
+  {
+    static thread_local std::array<StateVec, MaxDepth> _buffers = []() {
+      std::array<StateVec, MaxDepth> ret{};
+      for (auto& buffer : ret)
+        buffer.reserve(CellThreshold / 2 + ActionThreshold + 1);
+      return ret;
+    }();
+    return _buffers[depth];
+  }
+
+  StateT& state;
+  Base_Playout_Func base_playout;
+  bool solving;
+};
+
 } // namespace policies
 
 #endif
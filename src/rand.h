@@ -2,61 +2,380 @@
 #define __RANDOMUTILS_H_
 
 #include <array>
-#include <type_traits>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
 #include <random>
-#include <memory>
-#include <vector>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace Rand {
 
+/**
+ * SplitMix64, only used to expand a 64 bits seed into the state of Xoshiro256.
+ */
+inline constexpr uint64_t splitmix64(uint64_t& x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+/**
+ * The xoshiro256** engine of Blackman and Vigna: 256 bits of state, a period of
+ * 2^256 - 1, and a few shifts and rotations per number.
+ *
+ * @Note `jump()` advances the engine by 2^128 steps, which splits the period into
+ * non-overlapping streams (e.g. one per thread), see `Xoshiro256::stream`.
+ */
+class Xoshiro256
+{
+ public:
+  using result_type = uint64_t;
+
+  explicit Xoshiro256(uint64_t seed = 0) { this->seed(seed); }
+
+  /** The engine of the `n`th stream split from the given seed. */
+  static Xoshiro256 stream(uint64_t seed, unsigned int n)
+  {
+    Xoshiro256 ret(seed);
+    for (unsigned int i = 0; i < n; ++i)
+      ret.jump();
+    return ret;
+  }
+
+  void seed(uint64_t seed)
+  {
+    for (auto& s : m_state)
+      s = splitmix64(seed);
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()()
+  {
+    const uint64_t ret = rotl(m_state[1] * 5, 7) * 9;
+    const uint64_t t = m_state[1] << 17;
+
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = rotl(m_state[3], 45);
+
+    return ret;
+  }
+
+  /** Equivalent to 2^128 calls to operator(). */
+  void jump()
+  {
+    constexpr std::array<uint64_t, 4> JUMP = {
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+
+    std::array<uint64_t, 4> s{};
+    for (const uint64_t jump : JUMP)
+    {
+      for (int b = 0; b < 64; ++b)
+      {
+        if (jump & uint64_t{1} << b)
+        {
+          for (int i = 0; i < 4; ++i)
+            s[i] ^= m_state[i];
+        }
+        operator()();
+      }
+    }
+    m_state = s;
+  }
+
+  bool operator==(const Xoshiro256&) const = default;
+
+ private:
+  std::array<uint64_t, 4> m_state;
+
+  static constexpr uint64_t rotl(const uint64_t x, int k)
+  {
+    return (x << k) | (x >> (64 - k));
+  }
+};
+
+/**
+ * Random integers in [0, range) by Lemire's multiply-and-shift method: a single
+ * multiplication in the common case, and a division only when the result might
+ * be biased.
+ *
+ * @Note `range == 0` stands for the whole 64 bits range.
+ */
+template<typename Engine>
+inline uint64_t bounded(Engine& gen, uint64_t range)
+{
+  if (range == 0)
+    return gen();
+
+  if (range <= std::numeric_limits<uint32_t>::max())
+  {
+    // The high 32 bits of xoshiro256** are enough, and cheaper to multiply.
+    const uint32_t r32 = range;
+    uint64_t m = (gen() >> 32) * r32;
+    uint32_t low = m;
+    if (low < r32)
+    {
+      const uint32_t threshold = -r32 % r32;
+      while (low < threshold)
+      {
+        m = (gen() >> 32) * r32;
+        low = m;
+      }
+    }
+    return m >> 32;
+  }
+
+  __uint128_t m = static_cast<__uint128_t>(gen()) * range;
+  uint64_t low = m;
+  if (low < range)
+  {
+    const uint64_t threshold = -range % range;
+    while (low < threshold)
+    {
+      m = static_cast<__uint128_t>(gen()) * range;
+      low = m;
+    }
+  }
+  return m >> 64;
+}
+
+/************************************** Seeding ***********************************************/
+
+/** The seed used when the SG_SEED environment variable is not set. */
+inline constexpr uint64_t DEFAULT_SEED = 0x5eed5a3e6a3e0001;
+
+/**
+ * The generators drawing from the global seed, each one getting its own seed.
+ */
+enum class Domain : uint64_t
+{
+  zobrist = 1,
+  clusters,
+  search,
+  other
+};
+
+namespace detail {
+inline std::atomic<uint64_t>& seed_storage()
+{
+  static std::atomic<uint64_t> seed = []() -> uint64_t {
+    const char* env = std::getenv("SG_SEED");
+    return env ? std::strtoull(env, nullptr, 0) : DEFAULT_SEED;
+  }();
+  return seed;
+}
+inline std::atomic<unsigned int>& seed_epoch_storage()
+{
+  static std::atomic<unsigned int> epoch{0};
+  return epoch;
+}
+inline std::atomic<uint64_t>& seed_counter()
+{
+  static std::atomic<uint64_t> counter{0};
+  return counter;
+}
+inline std::atomic<unsigned int>& stream_counter()
+{
+  static std::atomic<unsigned int> counter{0};
+  return counter;
+}
+} // namespace detail
+
+/**
+ * The seed from which every random number generator of the process is derived:
+ * the value of the SG_SEED environment variable (read once), or DEFAULT_SEED.
+ */
+inline uint64_t global_seed()
+{
+  return detail::seed_storage().load(std::memory_order_relaxed);
+}
+/**
+ * Change the global seed. The generators obtained with `thread_util` pick it up on
+ * their next use.
+ *
+ * @Note The Zobrist keys don't depend on it, they are computed at compile time from
+ * DEFAULT_SEED so that every process agrees on them.
+ */
+inline void set_global_seed(uint64_t seed)
+{
+  detail::seed_storage().store(seed, std::memory_order_relaxed);
+  detail::seed_counter().store(0, std::memory_order_relaxed);
+  detail::seed_epoch_storage().fetch_add(1, std::memory_order_release);
+}
+/** Incremented by each call to set_global_seed. */
+inline unsigned int seed_epoch()
+{
+  return detail::seed_epoch_storage().load(std::memory_order_acquire);
+}
+
+/** The seed of the generators of the given domain, from some global seed. */
+inline constexpr uint64_t derive_seed(uint64_t seed, Domain domain)
+{
+  uint64_t x = seed ^ (static_cast<uint64_t>(domain) * 0xd1342543de82ef95);
+  return splitmix64(x);
+}
+
+/** The seed of the generators of the given domain. */
+inline uint64_t derive_seed(Domain domain)
+{
+  return derive_seed(global_seed(), domain);
+}
+
+/**
+ * A new seed for each call, in a deterministic sequence derived from the global seed.
+ */
+inline uint64_t next_seed()
+{
+  uint64_t x = derive_seed(Domain::other)
+               + detail::seed_counter().fetch_add(1, std::memory_order_relaxed)
+                     * 0x9e3779b97f4a7c15;
+  return splitmix64(x);
+}
+
+namespace detail {
+inline thread_local unsigned int thread_stream_ndx = stream_counter().fetch_add(1);
+}
+/**
+ * The index of the stream of the calling thread, see `thread_util`. The threads are
+ * numbered in the order they first ask for it, unless the index is set explicitly
+ * (e.g. by a worker pool, for runs independent of the scheduling).
+ */
+inline unsigned int thread_stream()
+{
+  return detail::thread_stream_ndx;
+}
+inline void set_thread_stream(unsigned int ndx)
+{
+  detail::thread_stream_ndx = ndx;
+}
+
 template<typename Int_T>
 class Util
 {
  public:
-  using Engine = typename std::
-      conditional<sizeof(Int_T) <= 4, std::mt19937, std::mt19937_64>::type;
+  using Engine = Xoshiro256;
+  using size_type = typename std::make_unsigned<Int_T>::type;
 
   Util() = default;
-  Util(typename Engine::result_type seed) : gen(seed) {}
-  using size_type = typename std::make_unsigned<Int_T>::type;
+  explicit Util(typename Engine::result_type seed) : gen(seed) {}
+  /** The `stream`th of the independent streams split from `seed`, see Xoshiro256::jump. */
+  Util(typename Engine::result_type seed, unsigned int stream)
+    : gen(Engine::stream(seed, stream))
+  {
+  }
 
   /**
    * Returns a number from _min to _max (including  _max!)
    */
   Int_T get(Int_T _min, Int_T _max)
   {
-    return std::uniform_int_distribution<Int_T>(_min, _max)(gen);
+    return _min + static_cast<Int_T>(bounded(gen, range(_min, _max)));
   }
 
+  /**
+   * Fill [_first, _last) with numbers from _min to _max, computing the range once.
+   */
+  template<typename OutputIt>
+  void fill(OutputIt _first, OutputIt _last, Int_T _min, Int_T _max)
+  {
+    const uint64_t r = range(_min, _max);
+    for (; _first != _last; ++_first)
+      *_first = _min + static_cast<Int_T>(bounded(gen, r));
+  }
+
+  /**
+   * Returns an array whose first `_end - _beg` elements are a random permutation
+   * of the integers of [_beg, _end).
+   */
   template<size_t N>
   auto gen_ordering(const Int_T _beg, const Int_T _end)
   {
     std::array<Int_T, N> ret{};
-    std::iota(ret.begin(), ret.begin() + _end-_beg, _beg);
-
-    for (int i=_beg; i<_end-_beg; ++i)
-    {
-      auto j = get(i, _end-_beg-1);
-      std::swap(ret[i], ret[j]);
-    }
+    std::iota(ret.begin(), ret.begin() + (_end - _beg), _beg);
+    shuffle<N>(ret, _end - _beg);
 
     return ret;
   }
 
+  /**
+   * Shuffle the first `sz` elements of the array (Fisher-Yates).
+   *
+   * @Note The swap indices are drawn two at a time from a single random number
+   * (Brackett-Rozinsky and Lemire), rejecting when the pair might be biased.
+   */
   template<size_t N>
   void shuffle(std::array<Int_T, N>& arr, Int_T sz)
   {
-    for (auto i = 0; i < sz; ++i)
+    static_assert(N <= std::numeric_limits<uint32_t>::max());
+    uint64_t n = sz;
+    for (; n > 2; n -= 2)
     {
-      auto j = get(i, sz-1);
-      std::swap(arr[i], arr[j]);
+      const uint64_t bound = n * (n - 1);
+      auto [j1, j2] = bounded_pair(n, bound);
+      while (j1 == n) // rejected
+        std::tie(j1, j2) = bounded_pair(n, bound);
+      std::swap(arr[n - 1], arr[j1]);
+      std::swap(arr[n - 2], arr[j2]);
     }
+    if (n == 2)
+      std::swap(arr[1], arr[bounded(gen, 2)]);
   }
 
+  Engine& engine() { return gen; }
+
  private:
-  Engine gen{std::random_device{}()};
+  Engine gen{next_seed()};
+
+  static uint64_t range(Int_T _min, Int_T _max)
+  {
+    // Wraps to 0 on the whole 64 bits range, as expected by `bounded`.
+    return static_cast<uint64_t>(static_cast<size_type>(_max - _min)) + 1;
+  }
+
+  /**
+   * Two indices, in [0, n) and [0, n - 1), from a single random number, or
+   * `{n, 0}` when the draw has to be rejected.
+   */
+  std::pair<uint64_t, uint64_t> bounded_pair(uint64_t n, uint64_t bound)
+  {
+    __uint128_t m = static_cast<__uint128_t>(gen()) * n;
+    const uint64_t j1 = m >> 64;
+    m = static_cast<__uint128_t>(static_cast<uint64_t>(m)) * (n - 1);
+    const uint64_t j2 = m >> 64;
+    if (static_cast<uint64_t>(m) < bound && static_cast<uint64_t>(m) < -bound % bound)
+      return {n, 0};
+    return {j1, j2};
+  }
 };
 
+/**
+ * The generator of the given domain for the calling thread: the `thread_stream()`th
+ * stream split from the domain's seed. It is reseeded after set_global_seed.
+ */
+template<typename Int_T, Domain D>
+Util<Int_T>& thread_util()
+{
+  thread_local unsigned int epoch = seed_epoch();
+  thread_local Util<Int_T> util{derive_seed(D), thread_stream()};
+  if (epoch != seed_epoch()) [[unlikely]]
+  {
+    epoch = seed_epoch();
+    util = Util<Int_T>{derive_seed(D), thread_stream()};
+  }
+  return util;
+}
+
 } // namespace Rand
 
 #endif
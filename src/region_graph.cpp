@@ -0,0 +1,362 @@
+#include "region_graph.h"
+#include "cells.h"
+
+#include <algorithm>
+
+namespace sg {
+
+RegionGraph::RegionGraph(const Grid& _grid) : m_grid(_grid)
+{
+  m_label.fill(REGION_NONE);
+  m_grid.n_empty_rows = 0;
+  update_empty_rows();
+
+  for (Cell cell = m_grid.n_empty_rows * WIDTH; cell < MAX_CELLS; ++cell)
+    m_cells.push_back(cell);
+  label(m_cells);
+}
+
+void RegionGraph::valid_actions(ClusterDataVec& _actions) const
+{
+  _actions.clear();
+  for (const Region& region : m_regions)
+  {
+    if (region.size > 1)
+      _actions.push_back(
+          ClusterData{.rep = region.rep, .color = region.color, .size = region.size});
+  }
+}
+
+bool RegionGraph::is_terminal() const
+{
+  return std::none_of(m_regions.begin(), m_regions.end(), [](const Region& region) {
+    return region.size > 1;
+  });
+}
+
+int RegionGraph::merge_potential(RegionId _id) const
+{
+  const Color color = m_regions[_id].color;
+  // Few regions are two edges away, a linear search is enough to count them once.
+  std::array<RegionId, MAX_CELLS> seen;
+  size_t n_seen = 0;
+  int ret = 0;
+  for_each_neighbour(_id, [&](RegionId between) {
+    for_each_neighbour(between, [&](RegionId other) {
+      if (other == _id || m_regions[other].color != color
+          || std::find(seen.begin(), seen.begin() + n_seen, other) != seen.begin() + n_seen)
+        return;
+      seen[n_seen++] = other;
+      ret += m_regions[other].size;
+    });
+  });
+  return ret;
+}
+
+ClusterData RegionGraph::apply_action(RegionId _id)
+{
+  const Region removed = m_regions[_id];
+  const ClusterData ret{.rep = removed.rep, .color = removed.color, .size = removed.size};
+  if (removed.size < 2)
+    return ret;
+
+  const int first_row = m_grid.n_empty_rows;
+  const int col_lo = std::max(removed.col_min - 1, 0);
+  const int col_hi = std::min(removed.col_max + 1, WIDTH - 1);
+
+  // The lowest removed cell of each column: only the cells above it fall, and
+  // only the cells next to those that fall may join other regions. A column
+  // emptied altogether (down to the bottom row) is pulled out, after which its two
+  // neighbours are side by side from top to bottom.
+  std::array<int, WIDTH> lowest;
+  for (int col = removed.col_min; col <= removed.col_max; ++col)
+  {
+    int row = HEIGHT - 1;
+    while (m_label[row * WIDTH + col] != _id)
+      --row;
+    lowest[col] = row;
+  }
+  auto lowest_near = [&](int col) {
+    int ret = -1;
+    for (int other = std::max(col - 1, int{removed.col_min});
+         other <= std::min(col + 1, int{removed.col_max}); ++other)
+      ret = std::max(ret, lowest[other] + (other == col));
+    return std::min(ret, HEIGHT - 1);
+  };
+
+  // The regions with cells in those rows are relabelled, the others keep their cells
+  // and their edges.
+  m_dirty.resize(m_regions.size(), 0);
+  auto& dirty_ids = m_dirty_ids;
+  dirty_ids.clear();
+  for (int col = col_lo; col <= col_hi; ++col)
+  {
+    const int last_row = lowest_near(col);
+    for (int row = first_row; row <= last_row; ++row)
+    {
+      const RegionId id = m_label[row * WIDTH + col];
+      if (id == REGION_NONE || m_dirty[id])
+        continue;
+      m_dirty[id] = 1;
+      dirty_ids.push_back(id);
+    }
+  }
+  for (const RegionId id : dirty_ids)
+  {
+    for_each_neighbour(id, [&](RegionId other) {
+      if (!m_dirty[other])
+        remove_edge(other, id);
+    });
+    clear_edges(id);
+  }
+
+  // Unlabel their cells, from their reps. Those which won't fall are kept to be
+  // labelled again, the others will be found in their columns.
+  auto falls = [&](Cell cell) {
+    const int col = cells::COL[cell];
+    return col >= removed.col_min && col <= removed.col_max
+           && cells::ROW[cell] <= lowest[col];
+  };
+  m_cells.clear();
+  for (const RegionId id : dirty_ids)
+  {
+    const Cell rep = m_regions[id].rep;
+    m_label[rep] = REGION_NONE;
+    m_stack.assign(1, rep);
+    while (!m_stack.empty())
+    {
+      const Cell cur = m_stack.back();
+      m_stack.pop_back();
+      if (id == _id)
+        m_grid[cur] = Color::Empty;
+      else if (!falls(cur))
+        m_cells.push_back(cur);
+      for (const Cell nbh : cells::NEIGHBOURS[cur])
+      {
+        if (m_label[nbh] == id)
+        {
+          m_label[nbh] = REGION_NONE;
+          m_stack.push_back(nbh);
+        }
+      }
+    }
+    m_dirty[id] = 0;
+    m_regions[id] = Region{};
+    m_free.push_back(id);
+  }
+  m_n_regions -= dirty_ids.size();
+
+  // Only the columns of the removed region fall, the cells falling are unlabelled.
+  for (int col = removed.col_min; col <= removed.col_max; ++col)
+  {
+    int to = CELL_BOTTOM_LEFT + col;
+    for (int from = to; from >= first_row * WIDTH; from -= WIDTH)
+    {
+      if (m_grid[from] == Color::Empty)
+        continue;
+      if (from != to)
+      {
+        m_grid[to] = m_grid[from];
+        m_grid[from] = Color::Empty;
+      }
+      to -= WIDTH;
+    }
+  }
+
+  // The empty columns are among them too, those on their right move with their labels.
+  // `pulled_before[col]` is the number of empty columns on the left of `col`.
+  std::array<int, WIDTH + 1> pulled_before;
+  int n_pulled = 0;
+  for (int col = removed.col_min; col < WIDTH; ++col)
+  {
+    if (col <= removed.col_max + 1)
+      pulled_before[col] = n_pulled;
+    if (m_grid[CELL_BOTTOM_LEFT + col] == Color::Empty)
+    {
+      n_pulled += col <= removed.col_max;
+      continue;
+    }
+    if (n_pulled == 0)
+      continue;
+    for (int row = first_row; row < HEIGHT; ++row)
+    {
+      const Cell from = row * WIDTH + col;
+      std::swap(m_grid[from - n_pulled], m_grid[from]);
+      std::swap(m_label[from - n_pulled], m_label[from]);
+    }
+  }
+  pulled_before[removed.col_max + 1] = n_pulled;
+  if (n_pulled > 0)
+  {
+    // No region left spans an empty column, they all move as a block.
+    for (Region& region : m_regions)
+    {
+      if (!region.alive() || region.col_min <= removed.col_min)
+        continue;
+      const int shift = pulled_before[std::min<int>(region.col_min, removed.col_max + 1)];
+      region.col_min -= shift;
+      region.col_max -= shift;
+      region.rep -= shift;
+    }
+  }
+
+  if (n_pulled > 0)
+  {
+    for (Cell& cell : m_cells)
+    {
+      const int col = cells::COL[cell];
+      if (col > removed.col_min)
+        cell -= pulled_before[std::min<int>(col, removed.col_max + 1)];
+    }
+  }
+  for (int col = removed.col_min; col <= removed.col_max; ++col)
+  {
+    if (pulled_before[col + 1] > pulled_before[col])
+      continue;
+    const int to_col = col - pulled_before[col];
+    for (int row = first_row; row <= lowest[col]; ++row)
+    {
+      if (m_grid[row * WIDTH + to_col] != Color::Empty)
+        m_cells.push_back(row * WIDTH + to_col);
+    }
+  }
+  label(m_cells);
+  update_empty_rows();
+  return ret;
+}
+
+RegionGraph::RegionId RegionGraph::new_region()
+{
+  ++m_n_regions;
+  if (!m_free.empty())
+  {
+    const RegionId ret = m_free.back();
+    m_free.pop_back();
+    return ret;
+  }
+  m_regions.emplace_back();
+  m_first_block.push_back(NO_BLOCK);
+  return m_regions.size() - 1;
+}
+
+void RegionGraph::add_edge(RegionId a, RegionId b)
+{
+  bool found = false;
+  for_each_neighbour(a, [&](RegionId other) { found |= other == b; });
+  if (found)
+    return;
+  push_edge(a, b);
+  push_edge(b, a);
+}
+
+void RegionGraph::push_edge(RegionId from, RegionId to)
+{
+  uint32_t& first = m_first_block[from];
+  if (first == NO_BLOCK || m_blocks[first].n == EdgeBlock::CAPACITY)
+  {
+    uint32_t block = m_free_block;
+    if (block == NO_BLOCK)
+    {
+      block = m_blocks.size();
+      m_blocks.emplace_back();
+    }
+    else
+      m_free_block = m_blocks[block].next;
+    m_blocks[block].n = 0;
+    m_blocks[block].next = first;
+    first = block;
+  }
+  EdgeBlock& block = m_blocks[first];
+  block.ids[block.n++] = to;
+}
+
+void RegionGraph::remove_edge(RegionId from, RegionId to)
+{
+  // Fill the hole with the last edge of the first block.
+  uint32_t& first = m_first_block[from];
+  EdgeBlock& head = m_blocks[first];
+  for (uint32_t block = first; block != NO_BLOCK; block = m_blocks[block].next)
+  {
+    auto& ids = m_blocks[block].ids;
+    auto it = std::find(ids.begin(), ids.begin() + m_blocks[block].n, to);
+    if (it == ids.begin() + m_blocks[block].n)
+      continue;
+    *it = head.ids[--head.n];
+    break;
+  }
+  if (head.n == 0)
+  {
+    const uint32_t next = head.next;
+    head.next = m_free_block;
+    m_free_block = first;
+    first = next;
+  }
+}
+
+void RegionGraph::clear_edges(RegionId id)
+{
+  uint32_t& first = m_first_block[id];
+  while (first != NO_BLOCK)
+  {
+    const uint32_t next = m_blocks[first].next;
+    m_blocks[first].next = m_free_block;
+    m_free_block = first;
+    first = next;
+  }
+}
+
+void RegionGraph::label(const std::vector<Cell>& _cells)
+{
+  for (const Cell seed : _cells)
+  {
+    if (m_label[seed] != REGION_NONE || m_grid[seed] == Color::Empty)
+      continue;
+    const RegionId id = new_region();
+    Region region{.rep = static_cast<PackedCell>(seed),
+                  .color = m_grid[seed],
+                  .col_min = cells::COL[seed],
+                  .col_max = cells::COL[seed]};
+    m_label[seed] = id;
+    m_stack.assign(1, seed);
+    // Neighbouring regions usually share several sides in a row.
+    RegionId last_linked = REGION_NONE;
+    while (!m_stack.empty())
+    {
+      const Cell cur = m_stack.back();
+      m_stack.pop_back();
+      ++region.size;
+      region.rep = std::min<PackedCell>(region.rep, cur);
+      region.col_min = std::min(region.col_min, cells::COL[cur]);
+      region.col_max = std::max(region.col_max, cells::COL[cur]);
+      for (const Cell nbh : cells::NEIGHBOURS[cur])
+      {
+        if (m_grid[nbh] == Color::Empty)
+          continue;
+        if (m_label[nbh] == REGION_NONE && m_grid[nbh] == region.color)
+        {
+          m_label[nbh] = id;
+          m_stack.push_back(nbh);
+        }
+        else if (m_label[nbh] != REGION_NONE && m_label[nbh] != id
+                 && m_label[nbh] != last_linked)
+        {
+          last_linked = m_label[nbh];
+          add_edge(id, last_linked);
+        }
+      }
+    }
+    m_regions[id] = region;
+  }
+}
+
+void RegionGraph::update_empty_rows()
+{
+  // The cells are pulled down, so the empty rows are above the others.
+  auto& top = m_grid.n_empty_rows;
+  while (top < HEIGHT
+         && std::all_of(m_grid.begin() + top * WIDTH, m_grid.begin() + (top + 1) * WIDTH,
+                        [](Color color) { return color == Color::Empty; }))
+    ++top;
+}
+
+} // namespace sg
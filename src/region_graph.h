@@ -0,0 +1,130 @@
+#ifndef __REGION_GRAPH_H_
+#define __REGION_GRAPH_H_
+
+#include "types.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace sg {
+
+/**
+ * The board as a graph of its regions: the connected sets of cells of a color
+ * (the clusters, trivial ones included) are the nodes, and the regions sharing a
+ * side are linked by an edge.
+ *
+ * The valid actions are the regions of two cells or more, without any flood fill.
+ * Removing a region only relabels the regions of the cells that fall and of the
+ * cells next to them (or next to a column pulled out): the others keep their id
+ * and their edges, their columns shifted if need be. That pays off when the regions
+ * are small, while large regions of few colors are costly to relabel.
+ *
+ * @Note It keeps its own copy of the grid, updated along with the graph.
+ */
+class RegionGraph
+{
+ public:
+  using RegionId = PackedCell;
+  static constexpr RegionId REGION_NONE = CELL_NONE;
+
+  struct Region
+  {
+    /** Its smallest cell. */
+    PackedCell rep{CELL_NONE};
+    Color color{Color::Empty};
+    PackedCell size{0};
+    /** The columns it spans, both included. */
+    uint16_t col_min{0};
+    uint16_t col_max{0};
+
+    bool alive() const { return size > 0; }
+  };
+
+  explicit RegionGraph(const Grid&);
+
+  const Grid& grid() const { return m_grid; }
+  /** The region of a non-empty cell, REGION_NONE for an empty one. */
+  RegionId region_of(Cell cell) const { return m_label[cell]; }
+  const Region& region(RegionId id) const { return m_regions[id]; }
+  /** Call `f(RegionId)` for each region adjacent to `id`, in no particular order. */
+  template<typename F>
+  void for_each_neighbour(RegionId id, F&& f) const
+  {
+    for (uint32_t block = m_first_block[id]; block != NO_BLOCK; block = m_blocks[block].next)
+    {
+      for (int i = 0; i < m_blocks[block].n; ++i)
+        f(m_blocks[block].ids[i]);
+    }
+  }
+  /** The ids up to which regions are found, some of them dead. */
+  size_t id_end() const { return m_regions.size(); }
+  int n_regions() const { return m_n_regions; }
+
+  /** The regions of two cells or more, in no particular order. */
+  void valid_actions(ClusterDataVec&) const;
+  bool is_terminal() const;
+  /**
+   * The number of cells of the regions of the same color as `id` two edges away
+   * from it: removing a region in between may merge them with `id`.
+   */
+  int merge_potential(RegionId id) const;
+
+  /**
+   * Remove the region (if valid), make the cells fall and pull the columns left,
+   * then update the graph.
+   *
+   * @Return The descriptor of the region, with a size of 0 or 1 if it was not a
+   * valid action (the graph is unchanged then).
+   */
+  ClusterData apply_action(RegionId);
+
+ private:
+  Grid m_grid;
+  std::array<RegionId, MAX_CELLS> m_label;
+  std::vector<Region> m_regions;
+
+  /**
+   * The edges of each region are kept in blocks chained from its first one, all of
+   * them full but the first. The blocks come from a common pool, so that building
+   * and copying the graph allocate little.
+   */
+  struct EdgeBlock
+  {
+    static constexpr int CAPACITY = 7;
+    std::array<RegionId, CAPACITY> ids;
+    uint8_t n;
+    uint32_t next;
+  };
+  static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+  std::vector<uint32_t> m_first_block;
+  std::vector<EdgeBlock> m_blocks;
+  /** The unused blocks, chained by `next`. */
+  uint32_t m_free_block{NO_BLOCK};
+
+  /** The ids of the dead regions, to be reused. */
+  std::vector<RegionId> m_free;
+  int m_n_regions{0};
+
+  // Buffers of apply_action, kept for their capacity.
+  std::vector<uint8_t> m_dirty;
+  std::vector<RegionId> m_dirty_ids;
+  std::vector<Cell> m_cells;
+  std::vector<Cell> m_stack;
+
+  RegionId new_region();
+  void add_edge(RegionId a, RegionId b);
+  void push_edge(RegionId from, RegionId to);
+  void remove_edge(RegionId from, RegionId to);
+  void clear_edges(RegionId);
+  /**
+   * Label the non-empty cells of `cells` (in increasing order and unlabelled)
+   * into new regions, and link them to their neighbours.
+   */
+  void label(const std::vector<Cell>& cells);
+  void update_empty_rows();
+};
+
+} // namespace sg
+
+#endif
@@ -4,8 +4,10 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cmath>
 #include <cstdint>
+#include <numeric>
 
 #include <iostream>
 #include <string>
@@ -40,7 +42,15 @@ State::State(key_type key, const Grid& cells, const ColorCounter& ccolors)
 
 ClusterDataVec State::valid_actions_data() const
 {
-  return clusters::get_valid_clusters_descriptors(m_cells);
+  ClusterDataVec ret{};
+  ret.reserve(MAX_CELLS / 2);
+  valid_actions_data(ret);
+  return ret;
+}
+
+void State::valid_actions_data(ClusterDataVec& actions) const
+{
+  clusters::get_valid_clusters_descriptors(m_cells, m_cnt_colors, actions);
 }
 
 bool key_uninitialized(const Grid& grid, Key key)
@@ -55,6 +65,14 @@ Key State::key()
   return m_key;
 }
 
+Key State::canonical_key()
+{
+  // Below two, no action is dropped. Like the cell keys, the column keys leave the
+  // two lowest bits of the key alone.
+  const Key key = this->key();
+  return m_last_col < 2 ? key : key ^ zobrist::get_column_key(m_last_col);
+}
+
 /**
  * First check if the key contains the answer, check for clusters but return
  * false as soon as it finds one instead of computing all clusters.
@@ -73,19 +91,126 @@ bool State::is_terminal() const
 
 bool State::apply_action(const ClusterData& cd)
 {
-  ClusterData res = clusters::apply_action(m_cells, cd.rep);
+  int col_min = m_last_col;
+  ClusterData res = clusters::apply_action(m_cells, cd.rep, col_min);
   m_cnt_colors[to_integral(res.color)] -= (res.size > 1) * res.size;
   m_key = 0;
+  m_last_col = col_min;
   return !is_trivial(res);
 }
 
+void State::generate_children(ClusterDataVec& actions, std::vector<State>& children) const
+{
+  build_children(actions, children, false);
+}
+
+void State::generate_canonical_children(ClusterDataVec& actions,
+                                        std::vector<State>& children) const
+{
+  build_children(actions, children, true);
+}
+
+namespace {
+
+/**
+ * The masks of the clusters for the calling thread, reserved for any grid. They are
+ * consumed before returning, so that the recursive searches can share them.
+ */
+std::vector<clusters::ClusterMask>& mask_buffer()
+{
+  static thread_local std::vector<clusters::ClusterMask> _masks = []() {
+    std::vector<clusters::ClusterMask> ret;
+    ret.reserve(MAX_ACTIONS);
+    return ret;
+  }();
+  return _masks;
+}
+
+/**
+ * Drop the actions (and their masks) lying left of the column `col`, one column
+ * apart at least, unless they all do: only the terminal states are left without
+ * any action, as the searches expect.
+ */
+void drop_commuting_actions(ClusterDataVec& actions,
+                            std::vector<clusters::ClusterMask>& masks,
+                            int col)
+{
+  if (col < 2)
+    return;
+  const uint64_t left_cols = (uint64_t{1} << (col - 1)) - 1;
+  size_t n_kept = 0;
+  for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+  {
+    if ((masks[ndx].cols & ~left_cols) == 0)
+      continue;
+    actions[n_kept] = actions[ndx];
+    masks[n_kept] = masks[ndx];
+    ++n_kept;
+  }
+  if (n_kept == 0)
+    return;
+  actions.resize(n_kept);
+  masks.resize(n_kept);
+}
+
+} // namespace
+
+void State::canonical_actions_data(ClusterDataVec& actions) const
+{
+  if (m_last_col < 2 || !clusters::CLUSTER_MASKS)
+    return valid_actions_data(actions);
+
+  auto& masks = mask_buffer();
+  clusters::get_valid_clusters_masks(m_cells, m_cnt_colors, actions, masks);
+  drop_commuting_actions(actions, masks, m_last_col);
+}
+
+void State::build_children(ClusterDataVec& actions,
+                           std::vector<State>& children,
+                           bool canonical) const
+{
+  // Without the masks, all the actions are kept.
+  if constexpr (!clusters::CLUSTER_MASKS)
+  {
+    valid_actions_data(actions);
+    children.assign(actions.size(), *this);
+    for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+      children[ndx].apply_action(actions[ndx]);
+    return;
+  }
+
+  auto& masks = mask_buffer();
+  clusters::get_valid_clusters_masks(m_cells, m_cnt_colors, actions, masks);
+  if (canonical)
+    drop_commuting_actions(actions, masks, m_last_col);
+  children.assign(actions.size(), *this);
+  for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+  {
+    State& child = children[ndx];
+    clusters::remove_cluster(child.m_cells, masks[ndx]);
+    child.m_cnt_colors[to_integral(actions[ndx].color)] -= actions[ndx].size;
+    child.m_key = 0;
+    child.m_last_col = std::countr_zero(masks[ndx].cols);
+  }
+}
+
 ClusterData State::apply_random_action(Color target)
 {
   ClusterData cd = clusters::apply_random_action(m_cells, target);
-  m_cnt_colors[to_integral(cd.color)] -= cd.size;
+  m_cnt_colors[to_integral(cd.color)] -= (cd.size > 1) * cd.size;
+  if (cd.size > 1)
+  {
+    m_key = 0;
+    m_last_col = 0;
+  }
   return cd;
 }
 
+int State::n_cells() const
+{
+  return std::accumulate(m_cnt_colors.begin() + 1, m_cnt_colors.end(), 0);
+}
+
 //*************************** Display *************************/
 
 ClusterData State::get_cd(Cell rep) const
@@ -135,7 +260,7 @@ std::ostream& operator<<(std::ostream& _out, const State& _state)
 
 std::ostream& operator<<(std::ostream& _out, const ClusterData& _cd)
 {
-  return _out << _cd.rep << ' ' << display::to_string(_cd.color) << ' '
+  return _out << Cell(_cd.rep) << ' ' << display::to_string(_cd.color) << ' '
               << std::to_string(_cd.size);
 }
 
@@ -158,5 +283,18 @@ State::reward_type State::evaluate_terminal() const
   return static_cast<reward_type>(is_empty()) * 1000.0 * 0.0025;
 }
 
+int score_sequence(State state, const std::vector<ClusterData>& actions)
+{
+  int score = 0;
+  for (const auto& action : actions)
+  {
+    const ClusterData cd = state.get_cd(action.rep);
+    if (cd.size < 2 || !state.apply_action(cd))
+      return -1;
+    score += (cd.size - 2) * (cd.size - 2);
+  }
+  return score + 1000 * state.is_empty();
+}
+
 
 } //namespace sg
@@ -25,12 +25,45 @@ class State
   using key_type = uint64_t;
 
   State();
+  /** Check the stream afterwards: it fails on a missing cell or color out of range. */
   explicit State(std::istream&);
   State(Grid&&, ColorCounter&&);
   State(key_type, const Grid&, const ColorCounter&);
 
   ClusterDataVec valid_actions_data() const;
+  /** Same as above, reusing the capacity of the given vector. */
+  void valid_actions_data(ClusterDataVec&) const;
   bool apply_action(const ClusterData&);
+  /**
+   * The valid actions, as above, and the states they lead to in `children`, in the
+   * same order. The clusters are labelled once and each child is built from the
+   * cells of its cluster, without flooding it again.
+   *
+   * @Note Both vectors are overwritten, reusing their capacity.
+   */
+  void generate_children(ClusterDataVec&, std::vector<State>& children) const;
+
+  /**
+   * Same as `valid_actions_data`, without the actions commuting with the last one
+   * applied which come first in the canonical order. Removing a cluster only moves
+   * the cells of its columns and of those on their right: a cluster lying left of
+   * it, one column apart at least, is left as it is, and playing it before reaches
+   * the same states. So the searches only play them in that order.
+   *
+   * @Note Playing the canonical actions only from every state still reaches all the
+   * states reachable from one with `clear_last_action`. When all the actions would
+   * be dropped, none is, so that only the terminal states have no action.
+   */
+  void canonical_actions_data(ClusterDataVec&) const;
+  /** Same as `generate_children`, for the canonical actions. */
+  void generate_canonical_children(ClusterDataVec&, std::vector<State>& children) const;
+  /** Make all the valid actions canonical, as if no action had been applied. */
+  void clear_last_action() { m_last_col = 0; }
+  /**
+   * The key of the state along with what makes its actions canonical: the states
+   * with the same key have the same canonical actions.
+   */
+  Key canonical_key();
   ClusterData apply_random_action(Color = Color::Empty);
   reward_type evaluate(const ClusterData&) const;
   reward_type evaluate_terminal() const;
@@ -38,6 +71,7 @@ class State
   Key key();
   bool is_trivial(const ClusterData& cd) const { return cd.size < 2; }
   bool is_empty() const { return m_cells[CELL_BOTTOM_LEFT] == Color::Empty; }
+  int n_cells() const;
   const Grid& grid() const { return m_cells; }
   const ColorCounter& color_counter() const { return m_cnt_colors; }
   friend std::ostream& operator<<(std::ostream&, const State&);
@@ -56,8 +90,18 @@ class State
   key_type m_key;
   Grid m_cells;
   ColorCounter m_cnt_colors;
+  /** The leftmost column of the last cluster removed, 0 if unknown. */
+  uint16_t m_last_col{0};
+
+  void build_children(ClusterDataVec&, std::vector<State>&, bool canonical) const;
 };
 
+/**
+ * The codingame score of the sequence: (n-2)^2 for each cluster of size n, and
+ * a bonus of 1000 for an empty grid. Returns -1 if some action is invalid.
+ */
+int score_sequence(State, const std::vector<ClusterData>&);
+
 /** Display a colored board with the chosen cluster highlighted. */
 extern std::ostream& operator<<(std::ostream&,
                                 const std::pair<const State&, Cell>&);
@@ -1,17 +1,23 @@
 #include "sghash.h"
 #include "zobrist.h"
 #include "clusterhelper.h"
+#include "rand.h"
 #include "types.h"
 
 namespace sg::zobrist {
 
-ZTable Table{};
+constexpr ZTable Table{Rand::derive_seed(Rand::DEFAULT_SEED, Rand::Domain::zobrist)};
 
 Key get_key(const Cell _cell, const Color _color)
 {
   return Table(_cell, _color);
 }
 
+Key get_column_key(int _col)
+{
+  return Table[MAX_CELLS * MAX_COLORS + _col];
+}
+
 /**
  * Xor with a unique random key for each (index, color) appearing in the grid.
  * Also compute is_terminal() (Key will have first bit on once is_terminal() is known,
@@ -52,7 +58,7 @@ Key get_key(const Grid& _grid)
       break;
   }
   // Repeat for first row but only checking the right neighbour for clusters
-  for (auto cell = CELL_UPPER_LEFT; cell < CELL_UPPER_RIGHT; ++cell)
+  for (auto cell = CELL_UPPER_LEFT; cell <= CELL_UPPER_RIGHT; ++cell)
   {
     if (const Color color = _grid[cell]; color != Color::Empty)
     {
@@ -71,9 +77,9 @@ Key get_key(const Grid& _grid)
     }
   }
 
-  // flip the first bit if we found out _grid was non-terminal earlier,
-  // otherwise flip both the first and second bit.
-  key += terminal_status_known ? 1 : 3;
+  // set the first bit if we found out _grid was non-terminal earlier,
+  // otherwise set both the first and second bit.
+  key |= terminal_status_known ? 1 : 3;
 
   return key;
 }
@@ -12,6 +12,8 @@ namespace sg::zobrist {
 
 /** The key associated to an individual cell. */
 Key get_key(const Cell, const Color);
+/** The key associated to a column, for the states to tell apart more than their grid. */
+Key get_column_key(int col);
 /**
  * Generate the grid's key using a Zobrist hashing scheme.
  */
@@ -22,16 +24,16 @@ Key get_key(const Grid&);
  */
 struct ZobristIndex
 {
-  //  NOTE: The upper left cell in the grid corresponds to 0,
-  // so wee need to increment the cells when computing the key!
-  auto operator()(const Cell cell, const Color color)
+  // One key per cell and non-empty color.
+  constexpr auto operator()(const Cell cell, const Color color) const
   {
-    return (cell + 1) * to_integral(color);
+    return cell * MAX_COLORS + to_integral(color) - 1;
   }
 };
 
 typedef ::zobrist::KeyTable<ZobristIndex, sg::Key, N_ZOBRIST_KEYS> ZTable;
-extern ZTable Table;
+/** Computed at compile time, the same in every process whatever SG_SEED. */
+extern const ZTable Table;
 
 } // namespace sg::zobrist
 
@@ -0,0 +1,208 @@
+#include "solve_service.h"
+#include "agents.h"
+#include "rand.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace sg {
+
+//************************************** Boards *****************************************/
+
+bool is_board_row(const std::string& line)
+{
+  std::istringstream iss{line};
+  int color = 0;
+  for (int col = 0; col < WIDTH; ++col)
+  {
+    if (!(iss >> color) || color < -1 || color >= MAX_COLORS)
+      return false;
+  }
+  return (iss >> std::ws).eof();
+}
+
+bool parse_board(const std::vector<std::string>& rows, State& board)
+{
+  if (rows.size() != HEIGHT || !std::all_of(rows.begin(), rows.end(), is_board_row))
+    return false;
+  std::string text;
+  for (const auto& row : rows)
+    text += row + '\n';
+  std::istringstream iss{text};
+  State parsed(iss);
+  if (!iss)
+    return false;
+  board = parsed;
+  return true;
+}
+
+//************************************** Latencies **************************************/
+
+void LatencyWindow::add(double ms)
+{
+  if (m_latencies.size() < m_capacity)
+  {
+    m_latencies.push_back(ms);
+    return;
+  }
+  m_latencies[m_next] = ms;
+  m_next = (m_next + 1) % m_capacity;
+}
+
+double LatencyWindow::quantile(double q) const
+{
+  if (m_latencies.empty())
+    return 0.0;
+  std::vector<double> sorted(m_latencies);
+  const size_t ndx = std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()));
+  std::nth_element(sorted.begin(), sorted.begin() + ndx, sorted.end());
+  return sorted[ndx];
+}
+
+//************************************** Service ****************************************/
+
+struct SolveService::Job
+{
+  Request request;
+  Callback callback;
+  std::chrono::steady_clock::time_point submitted;
+};
+
+namespace {
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                   - start)
+      .count();
+}
+
+} // namespace
+
+SolveService::SolveService(const Config& config) : m_config(config)
+{
+  const unsigned int n_workers = std::max(config.n_workers, 1u);
+  m_workers.reserve(n_workers);
+  for (unsigned int i = 0; i < n_workers; ++i)
+    m_workers.emplace_back([this, i] { work(i); });
+}
+
+SolveService::~SolveService()
+{
+  {
+    std::lock_guard lock(m_mutex);
+    m_quit = true;
+  }
+  m_work_cv.notify_all();
+  for (auto& worker : m_workers)
+    worker.join();
+}
+
+size_t SolveService::submit(Request request, Callback callback)
+{
+  size_t ret;
+  {
+    std::lock_guard lock(m_mutex);
+    m_queue.push_back(
+        Job{std::move(request), std::move(callback), std::chrono::steady_clock::now()});
+    ret = m_queue.size();
+    ++m_n_unfinished;
+  }
+  m_work_cv.notify_one();
+  return ret;
+}
+
+SolveService::Stats SolveService::stats() const
+{
+  std::lock_guard lock(m_mutex);
+  return Stats{.queue_depth = m_queue.size(),
+               .running = m_running,
+               .completed = m_completed,
+               .latency_p50_ms = m_latencies.quantile(0.5),
+               .latency_p90_ms = m_latencies.quantile(0.9),
+               .latency_p99_ms = m_latencies.quantile(0.99),
+               .latency_max_ms = m_latencies.quantile(1.0)};
+}
+
+void SolveService::wait_idle()
+{
+  std::unique_lock lock(m_mutex);
+  m_idle_cv.wait(lock, [this] { return m_n_unfinished == 0; });
+}
+
+void SolveService::work(unsigned int worker_ndx)
+{
+  // The random streams then depend on the worker, not on the thread creation order.
+  Rand::set_thread_stream(worker_ndx);
+
+  std::unique_lock lock(m_mutex);
+  while (true)
+  {
+    m_work_cv.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+    if (m_queue.empty())
+      return;
+
+    const Job job = std::move(m_queue.front());
+    m_queue.pop_front();
+    ++m_running;
+    lock.unlock();
+
+    const Progress result = solve(job);
+
+    lock.lock();
+    --m_running;
+    ++m_completed;
+    m_latencies.add(ms_since(job.submitted));
+    // The client sees the statistics including its request.
+    lock.unlock();
+    job.callback(result);
+    lock.lock();
+    if (--m_n_unfinished == 0)
+      m_idle_cv.notify_all();
+  }
+}
+
+SolveService::Progress SolveService::solve(const Job& job)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const unsigned int max_time_ms = std::max(job.request.max_time_ms, 1u);
+
+  State state = job.request.board;
+  MctsAgent mcts(state);
+  configure(mcts, m_config.expl_cst);
+
+  Progress progress{};
+  progress.queue_ms = std::chrono::duration<double, std::milli>(start - job.submitted).count();
+
+  // Search by slices of `progress_ms`, reporting the best sequence after each one
+  // which improved it. The final report is left to the caller.
+  progress.score = -1;
+  while (!progress.done)
+  {
+    const auto elapsed_ms = static_cast<unsigned int>(ms_since(start));
+    const unsigned int remaining_ms = elapsed_ms < max_time_ms ? max_time_ms - elapsed_ms : 1;
+    const unsigned int slice_ms =
+        m_config.progress_ms > 0 ? std::min(m_config.progress_ms, remaining_ms) : remaining_ms;
+    mcts.set_max_time(slice_ms);
+    mcts.run();
+
+    progress.iterations += mcts.get_iterations_cnt();
+    progress.n_nodes = mcts.get_n_nodes();
+    progress.search_ms = ms_since(start);
+    progress.done = mcts.is_solved() || progress.search_ms >= max_time_ms;
+
+    auto actions = mcts.peek_best_sequence(MctsAgent::ActionSelection::by_n_visits);
+    const int score = score_sequence(job.request.board, actions);
+    if (score > progress.score)
+    {
+      progress.score = score;
+      progress.actions = std::move(actions);
+      if (!progress.done)
+        job.callback(progress);
+    }
+  }
+  return progress;
+}
+
+} // namespace sg
@@ -0,0 +1,147 @@
+#ifndef __SOLVE_SERVICE_H_
+#define __SOLVE_SERVICE_H_
+
+#include "samegame.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sg {
+
+/**
+ * Whether the line is a row of a board in the format of data/input.txt: WIDTH
+ * colors from -1 (an empty cell) to MAX_COLORS - 1.
+ */
+bool is_board_row(const std::string& line);
+
+/**
+ * Read a board sent as its rows, which have to be HEIGHT valid rows.
+ *
+ * @Return false if they are not, leaving the board unchanged.
+ */
+bool parse_board(const std::vector<std::string>& rows, State& board);
+
+/**
+ * The latencies of the last requests, from which the percentiles are computed.
+ */
+class LatencyWindow
+{
+ public:
+  explicit LatencyWindow(size_t capacity = 1024) : m_capacity(capacity) {}
+
+  void add(double ms);
+  /** The `q`th quantile (between 0 and 1) of the window, 0 if it is empty. */
+  double quantile(double q) const;
+  size_t size() const { return m_latencies.size(); }
+
+ private:
+  size_t m_capacity;
+  size_t m_next = 0;
+  std::vector<double> m_latencies;
+};
+
+/**
+ * Solve boards on a fixed pool of worker threads.
+ *
+ * The requests wait in a FIFO queue for a free worker, which searches for the time
+ * budget of the request and reports the best sequence found at regular intervals.
+ * The workers live as long as the service, and so do their thread-local caches (the
+ * DSU of the cluster kernels, the transposition table and buffers of the playouts):
+ * only the first requests of each worker pay for warming them up.
+ */
+class SolveService
+{
+ public:
+  struct Config
+  {
+    unsigned int n_workers = 1;
+    double expl_cst = 1.0;
+    /** The interval between two progress reports of a search. */
+    unsigned int progress_ms = 100;
+  };
+
+  struct Request
+  {
+    State board;
+    unsigned int max_time_ms;
+  };
+
+  /** The state of a search, reported while it runs and once at the end. */
+  struct Progress
+  {
+    bool done = false;
+    /** The best sequence so far, from the board of the request. */
+    std::vector<ClusterData> actions;
+    int score = 0;
+    unsigned int iterations = 0;
+    size_t n_nodes = 0;
+    /** The time the request spent in the queue. */
+    double queue_ms = 0.0;
+    /** The time spent searching so far. */
+    double search_ms = 0.0;
+  };
+
+  /**
+   * Called by the worker thread of the request, so it must not block for long.
+   */
+  using Callback = std::function<void(const Progress&)>;
+
+  struct Stats
+  {
+    size_t queue_depth = 0;
+    size_t running = 0;
+    uint64_t completed = 0;
+    /** Over the last completed requests, from submission to the last report. */
+    double latency_p50_ms = 0.0;
+    double latency_p90_ms = 0.0;
+    double latency_p99_ms = 0.0;
+    double latency_max_ms = 0.0;
+  };
+
+  explicit SolveService(const Config&);
+  /** Finish the requests already submitted, then stop the workers. */
+  ~SolveService();
+  SolveService(const SolveService&) = delete;
+  SolveService& operator=(const SolveService&) = delete;
+
+  /**
+   * Queue the request.
+   *
+   * @Return The number of requests waiting for a worker, this one included.
+   */
+  size_t submit(Request, Callback);
+
+  Stats stats() const;
+
+  /** Block until every request submitted so far is done. */
+  void wait_idle();
+
+ private:
+  struct Job;
+
+  Config m_config;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_idle_cv;
+  std::deque<Job> m_queue;
+  size_t m_running = 0;
+  /** The requests submitted whose final report isn't sent yet. */
+  size_t m_n_unfinished = 0;
+  uint64_t m_completed = 0;
+  LatencyWindow m_latencies;
+  bool m_quit = false;
+  std::vector<std::thread> m_workers;
+
+  void work(unsigned int worker_ndx);
+  Progress solve(const Job&);
+};
+
+} // namespace sg
+
+#endif
@@ -0,0 +1,162 @@
+#include "solver.h"
+#include "agents.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace sg {
+
+/**
+ * The agent searches from its own copy of the board, which it holds by reference.
+ */
+struct Solver::Session
+{
+  explicit Session(const State& board, const Config& config)
+    : state(board), expected(board), mcts(state)
+  {
+    configure(mcts, config.expl_cst);
+  }
+
+  State state;
+  /** The board of the root of the tree. */
+  State expected;
+  MctsAgent mcts;
+};
+
+/**
+ * A thread running the searches in the background. It lives as long as the solver,
+ * so that its thread-local caches stay warm from one turn to the next.
+ */
+class Solver::Pondering
+{
+ public:
+  Pondering() : m_thread([this] { loop(); }) {}
+  ~Pondering()
+  {
+    stop();
+    {
+      std::lock_guard lock(m_mutex);
+      m_quit = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+  }
+
+  /**
+   * Search with the agent without time limit, until `stop()` is called or the
+   * tree is solved.
+   */
+  void start(MctsAgent& mcts)
+  {
+    std::lock_guard lock(m_mutex);
+    m_stop_flag = false;
+    mcts.set_stop_flag(&m_stop_flag);
+    mcts.set_max_time(0);
+    p_mcts = &mcts;
+    m_started = true;
+    m_cv.notify_all();
+  }
+
+  /**
+   * Wait for the search to return, the agent can then be used again.
+   *
+   * @Return The number of iterations made since `start()`.
+   */
+  unsigned int stop()
+  {
+    std::unique_lock lock(m_mutex);
+    if (!m_started)
+      return 0;
+    m_stop_flag = true;
+    m_cv.wait(lock, [this] { return p_mcts == nullptr; });
+    m_started = false;
+    return m_n_iterations;
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::atomic<bool> m_stop_flag{false};
+  /** The agent to search with, until the search returns. */
+  MctsAgent* p_mcts = nullptr;
+  bool m_started = false;
+  bool m_quit = false;
+  unsigned int m_n_iterations = 0;
+  std::thread m_thread;
+
+  void loop()
+  {
+    std::unique_lock lock(m_mutex);
+    while (true)
+    {
+      m_cv.wait(lock, [this] { return m_quit || p_mcts != nullptr; });
+      if (m_quit)
+        return;
+
+      lock.unlock();
+      p_mcts->run();
+      lock.lock();
+
+      m_n_iterations = p_mcts->get_iterations_cnt();
+      p_mcts->set_stop_flag(nullptr);
+      p_mcts = nullptr;
+      m_cv.notify_all();
+    }
+  }
+};
+
+Solver::Solver() : Solver(Config{}) {}
+
+Solver::Solver(const Config& config)
+  : m_config(config),
+    p_session(),
+    p_pondering(config.ponder ? std::make_unique<Pondering>() : nullptr),
+    m_last_turn()
+{
+}
+
+Solver::~Solver() = default;
+
+ClusterData Solver::play(const State& board, unsigned int max_time_ms)
+{
+  m_last_turn = TurnStats{};
+  if (p_pondering)
+  {
+    // Waiting for the iteration in progress to end is part of the turn's budget.
+    const auto start = std::chrono::steady_clock::now();
+    m_last_turn.ponder_iterations = p_pondering->stop();
+    const auto stop_ms = std::chrono::ceil<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    max_time_ms = max_time_ms > stop_ms ? max_time_ms - stop_ms : 0;
+  }
+
+  m_last_turn.tree_reused = p_session && p_session->expected == board;
+  if (!m_last_turn.tree_reused)
+    p_session = std::make_unique<Session>(board, m_config);
+
+  MctsAgent& mcts = p_session->mcts;
+  m_last_turn.inherited_visits = mcts.get_root_visits();
+  // A budget of 0 would mean no limit at all.
+  mcts.set_max_time(std::max(max_time_ms, 1u));
+
+  const ClusterData action =
+      mcts.best_sequence_action(MctsAgent::ActionSelection::by_n_visits);
+
+  m_last_turn.iterations = mcts.get_iterations_cnt();
+  m_last_turn.n_nodes = mcts.get_n_nodes();
+  if (!p_session->expected.is_trivial(action))
+    p_session->expected.apply_action(action);
+  return action;
+}
+
+void Solver::ponder()
+{
+  if (p_pondering && p_session && !p_session->expected.is_terminal())
+    p_pondering->start(p_session->mcts);
+}
+
+} // namespace sg
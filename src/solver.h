@@ -0,0 +1,87 @@
+#ifndef __SOLVER_H_
+#define __SOLVER_H_
+
+#include "samegame.h"
+
+#include <memory>
+
+namespace sg {
+
+/**
+ * A search which lives across the turns of a game.
+ *
+ * Each turn searches from the given board for a time budget and plays the first
+ * action of the best sequence found. When the board of the next turn is the one
+ * this action led to, the search goes on with the same tree and best line;
+ * otherwise it starts over from the new board.
+ *
+ * With pondering on, a background thread keeps searching below the action played
+ * until the next turn begins, so that the time spent waiting for the next board
+ * goes into the tree.
+ */
+class Solver
+{
+ public:
+  struct Config
+  {
+    double expl_cst = 1.0;
+    bool ponder = false;
+  };
+
+  /** What happened during the last turn. */
+  struct TurnStats
+  {
+    /** False if the search started over from the board of the turn. */
+    bool tree_reused = false;
+    /** The visits of the root made during the previous turns. */
+    int inherited_visits = 0;
+    /** Each iteration of the turn visits the root once. */
+    unsigned int iterations = 0;
+    /** The iterations made while pondering since the previous turn, kept or not. */
+    unsigned int ponder_iterations = 0;
+    size_t n_nodes = 0;
+
+    /** The share of the root's visits which were made during the previous turns. */
+    double reuse_rate() const
+    {
+      const double root_visits = inherited_visits + iterations;
+      return root_visits > 0 ? inherited_visits / root_visits : 0.0;
+    }
+  };
+
+  Solver();
+  explicit Solver(const Config&);
+  ~Solver();
+  Solver(const Solver&) = delete;
+  Solver& operator=(const Solver&) = delete;
+
+  /**
+   * Search from the board for `max_time_ms` milliseconds and play the best action.
+   *
+   * @Return The action played, trivial if the board is terminal.
+   */
+  ClusterData play(const State& board, unsigned int max_time_ms);
+
+  /**
+   * With pondering on, search in the background below the last action played until
+   * the next call to `play`. Call it once the action is sent, so that the thread
+   * waking up doesn't delay the answer.
+   */
+  void ponder();
+
+  const TurnStats& last_turn() const { return m_last_turn; }
+
+ private:
+  struct Session;
+  class Pondering;
+
+  Config m_config;
+  std::unique_ptr<Session> p_session;
+  /** Declared after the session, so that it stops searching before it is destroyed. */
+  std::unique_ptr<Pondering> p_pondering;
+  TurnStats m_last_turn;
+};
+
+} // namespace sg
+
+#endif
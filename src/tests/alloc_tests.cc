@@ -0,0 +1,126 @@
+#include "alloc_counter.h"
+#include "boards.h"
+#include "samegame.h"
+#include "mcts.h"
+#include "policies.h"
+#include "rand.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <string>
+
+namespace {
+
+using namespace sg;
+using tests::full_grid;
+
+/**
+ * The hot paths of the search must not allocate once warmed up: the allocator
+ * becomes a point of contention as soon as several threads search.
+ */
+class AllocationTest : public ::testing::Test {
+protected:
+    AllocationTest()
+    {
+        Rand::set_global_seed(2021);
+        std::istringstream iss{full_grid};
+        state = State(iss);
+    }
+
+    /** Play a whole game with the playout policy, from a copy of the state. */
+    template<typename Playout_Func>
+    void playout()
+    {
+        State tmp_state = state;
+        Playout_Func playout_func(tmp_state);
+        while (!tmp_state.is_trivial(playout_func()))
+            ;
+    }
+
+    State state;
+};
+
+TEST_F(AllocationTest, ValidActionsIntoABufferDoNotAllocate)
+{
+    ClusterDataVec actions{};
+    actions.reserve(MAX_CELLS / 2);
+
+    alloc_counter::Scope scope{};
+    State tmp_state = state;
+    while (!tmp_state.is_terminal())
+    {
+        tmp_state.valid_actions_data(actions);
+        tmp_state.apply_action(actions.front());
+    }
+
+    EXPECT_EQ(scope.allocations(), 0);
+}
+
+TEST_F(AllocationTest, RandomPlayoutsDoNotAllocate)
+{
+    using Playout_Func = policies::Default_Playout_Func<State, ClusterData>;
+    playout<Playout_Func>();
+
+    alloc_counter::Scope scope{};
+    for (int i = 0; i < 100; ++i)
+        playout<Playout_Func>();
+
+    EXPECT_EQ(scope.allocations(), 0);
+}
+
+TEST_F(AllocationTest, HybridPlayoutsDoNotAllocateOnceWarm)
+{
+    using Playout_Func = policies::Hybrid_Playout_Func<State, ClusterData, 20, 0, 8>;
+    for (int i = 0; i < 10; ++i)
+        playout<Playout_Func>();
+
+    alloc_counter::Scope scope{};
+    for (int i = 0; i < 100; ++i)
+        playout<Playout_Func>();
+
+    EXPECT_EQ(scope.allocations(), 0);
+}
+
+TEST_F(AllocationTest, SearchIterationsDoNotAllocateOnceWarm)
+{
+    using MctsAgent = mcts::Mcts<State, ClusterData>;
+    for (auto strategy : {MctsAgent::ExpansionStrategy::full,
+                          MctsAgent::ExpansionStrategy::progressive})
+    {
+        State _state = state;
+        MctsAgent mcts(_state);
+        mcts.set_expansion_strategy(strategy);
+        mcts.set_max_time(0);
+        mcts.reserve(1 << 16, 1 << 20);
+
+        mcts.set_max_iterations(100);
+        mcts.run();
+
+        alloc_counter::Scope scope{};
+        mcts.set_max_iterations(2000);
+        mcts.run();
+
+        EXPECT_EQ(mcts.get_iterations_cnt(), 2000);
+        EXPECT_LT(mcts.get_n_nodes(), 1 << 16);
+        EXPECT_EQ(scope.allocations(), 0)
+            << "over " << mcts.get_iterations_cnt() << " iterations";
+    }
+}
+
+TEST_F(AllocationTest, TheTreeGrowsWithoutReservingToo)
+{
+    using MctsAgent = mcts::Mcts<State, ClusterData>;
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_time(0);
+    mcts.set_max_iterations(100);
+    mcts.run();
+
+    alloc_counter::Scope scope{};
+    mcts.set_max_iterations(2000);
+    mcts.run();
+
+    // Only the node blocks and the tables grow, geometrically.
+    EXPECT_LT(scope.allocations(), 100);
+}
+
+} // namespace
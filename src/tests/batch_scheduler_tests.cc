@@ -0,0 +1,91 @@
+#include "batch_scheduler.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+
+using namespace sg;
+
+TEST(BatchSchedulerTest, TriesEveryBoardFirst)
+{
+    BatchScheduler scheduler(3);
+    for (size_t board = 0; board < 3; ++board)
+    {
+        EXPECT_EQ(scheduler.next(), board);
+        scheduler.update(board, 0.0);
+    }
+}
+
+TEST(BatchSchedulerTest, FavorsTheBoardsStillImproving)
+{
+    BatchScheduler scheduler(3);
+    std::vector<int> n_slices(3, 0);
+    for (int i = 0; i < 300; ++i)
+    {
+        const size_t board = scheduler.next();
+        ++n_slices[board];
+        scheduler.update(board, board == 1 ? 0.05 : 0.0);
+    }
+
+    EXPECT_GT(n_slices[1], 2 * n_slices[0]);
+    EXPECT_GT(n_slices[1], 2 * n_slices[2]);
+    // The others are still tried from time to time.
+    EXPECT_GT(n_slices[0], 1);
+    EXPECT_GT(n_slices[2], 1);
+}
+
+TEST(BatchSchedulerTest, ForgetsTheOldImprovements)
+{
+    BatchScheduler scheduler(2);
+    for (int i = 0; i < 100; ++i)
+    {
+        const size_t board = scheduler.next();
+        scheduler.update(board, board == 0 ? 0.05 : 0.0);
+    }
+    // Board 0 converged, board 1 starts improving.
+    std::vector<int> n_slices(2, 0);
+    for (int i = 0; i < 200; ++i)
+    {
+        const size_t board = scheduler.next();
+        if (i >= 100)
+            ++n_slices[board];
+        scheduler.update(board, board == 1 ? 0.05 : 0.0);
+    }
+
+    EXPECT_GT(n_slices[1], 2 * n_slices[0]);
+}
+
+TEST(BatchSchedulerTest, RoundRobin)
+{
+    BatchScheduler scheduler(
+        3, BatchScheduler::Config{.strategy = BatchScheduler::Strategy::round_robin});
+    std::vector<size_t> boards;
+    for (int i = 0; i < 6; ++i)
+    {
+        boards.push_back(scheduler.next());
+        scheduler.update(boards.back(), i == 0 ? 1.0 : 0.0);
+    }
+
+    EXPECT_EQ(boards, (std::vector<size_t>{0, 1, 2, 0, 1, 2}));
+}
+
+TEST(BatchSchedulerTest, SkipsTheRetiredBoards)
+{
+    for (auto strategy : {BatchScheduler::Strategy::bandit, BatchScheduler::Strategy::round_robin})
+    {
+        BatchScheduler scheduler(3, BatchScheduler::Config{.strategy = strategy});
+        scheduler.retire(0);
+        scheduler.retire(2);
+        EXPECT_EQ(scheduler.n_active(), 1);
+        for (int i = 0; i < 5; ++i)
+        {
+            EXPECT_EQ(scheduler.next(), 1);
+            scheduler.update(1, 0.0);
+        }
+        scheduler.retire(1);
+        EXPECT_EQ(scheduler.n_active(), 0);
+        EXPECT_EQ(scheduler.next(), 3);
+    }
+}
+
+} // namespace
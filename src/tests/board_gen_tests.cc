@@ -0,0 +1,101 @@
+#include "board_gen.h"
+#include "samegame.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace sg;
+
+/** The number of pairs of adjacent cells of the same color. */
+int same_color_pairs(const Grid& grid)
+{
+    int ret = 0;
+    for (int row = 0; row < HEIGHT; ++row)
+    {
+        for (int col = 0; col < WIDTH; ++col)
+        {
+            const Color color = grid[row * WIDTH + col];
+            if (color == Color::Empty)
+                continue;
+            ret += col + 1 < WIDTH && grid[row * WIDTH + col + 1] == color;
+            ret += row + 1 < HEIGHT && grid[(row + 1) * WIDTH + col] == color;
+        }
+    }
+    return ret;
+}
+
+TEST(BoardGenTest, TheBoardsOnlyDependOnTheSeedAndTheIndex)
+{
+    const gen::Params params{};
+
+    EXPECT_EQ(gen::generate(params, 42, 7).grid(), gen::generate(params, 42, 7).grid());
+    EXPECT_FALSE(gen::generate(params, 42, 7).grid() == gen::generate(params, 42, 8).grid());
+    EXPECT_FALSE(gen::generate(params, 42, 7).grid() == gen::generate(params, 43, 7).grid());
+}
+
+TEST(BoardGenTest, FillsTheBottomLeftCorner)
+{
+    const gen::Params params{.width = 6, .height = 4, .n_colors = 3};
+    const State state = gen::generate(params, 1, 0);
+
+    int n_cells = 0;
+    for (int row = 0; row < HEIGHT; ++row)
+    {
+        for (int col = 0; col < WIDTH; ++col)
+        {
+            const int color = to_integral(state.grid()[row * WIDTH + col]);
+            const bool filled = row >= HEIGHT - 4 && col < 6;
+            EXPECT_EQ(color != 0, filled) << row << ' ' << col;
+            EXPECT_LE(color, 3);
+            n_cells += filled;
+        }
+    }
+    int n_counted = 0;
+    for (int color = 1; color <= MAX_COLORS; ++color)
+        n_counted += state.color_counter()[color];
+    EXPECT_EQ(n_counted, n_cells);
+    EXPECT_EQ(state.grid().n_empty_rows, HEIGHT - 4);
+}
+
+TEST(BoardGenTest, FollowsTheWeights)
+{
+    const gen::Params params{.n_colors = 3, .weights = {1.0, 0.0, 3.0}};
+    int counts[4] = {};
+    for (uint64_t ndx = 0; ndx < 20; ++ndx)
+    {
+        const State state = gen::generate(params, 5, ndx);
+        for (int color = 1; color <= 3; ++color)
+            counts[color] += state.color_counter()[color];
+    }
+
+    EXPECT_EQ(counts[2], 0);
+    // 4500 cells, a quarter of them expected of the first color.
+    EXPECT_NEAR(counts[1] / 4500.0, 0.25, 0.03);
+}
+
+TEST(BoardGenTest, ClusteringMakesLargerClusters)
+{
+    gen::Params params{.n_colors = 5};
+    int independent = 0, clustered = 0;
+    for (uint64_t ndx = 0; ndx < 20; ++ndx)
+    {
+        params.clustering = 0.0;
+        independent += same_color_pairs(gen::generate(params, 3, ndx).grid());
+        params.clustering = 0.7;
+        clustered += same_color_pairs(gen::generate(params, 3, ndx).grid());
+    }
+
+    EXPECT_GT(clustered, 2 * independent);
+}
+
+TEST(BoardGenTest, RejectsTheInvalidParameters)
+{
+    EXPECT_EQ(gen::check(gen::Params{}), "");
+    EXPECT_NE(gen::check(gen::Params{.width = WIDTH + 1}), "");
+    EXPECT_NE(gen::check(gen::Params{.n_colors = MAX_COLORS + 1}), "");
+    EXPECT_NE(gen::check(gen::Params{.n_colors = 2, .weights = {1.0}}), "");
+    EXPECT_NE(gen::check(gen::Params{.n_colors = 2, .weights = {0.0, 0.0}}), "");
+    EXPECT_NE(gen::check(gen::Params{.clustering = 1.5}), "");
+}
+
+} // namespace
@@ -0,0 +1,23 @@
+#ifndef __TESTS_BOARDS_H_
+#define __TESTS_BOARDS_H_
+
+#include "types.h"
+#include <string>
+
+namespace sg::tests {
+
+/** A full board with a few colors, patterned so that the clusters stay small. */
+inline const std::string full_grid = []() {
+    std::string ret{};
+    for (int row = 0; row < HEIGHT; ++row)
+    {
+        for (int col = 0; col < WIDTH; ++col)
+            ret += std::to_string((row * 7 + col * 3 + (row * col) % 5) % 4) + ' ';
+        ret += '\n';
+    }
+    return ret;
+}();
+
+} // namespace sg::tests
+
+#endif
@@ -0,0 +1,95 @@
+#include "board_gen.h"
+#include "cells.h"
+#include "rand.h"
+#include "samegame.h"
+#include "sghash.h"
+#include "zobrist.h"
+#include "gtest/gtest.h"
+#include <set>
+#include <vector>
+
+namespace {
+
+using namespace sg;
+
+TEST(CellsTest, TheNeighboursAreTheAdjacentCells)
+{
+    for (int row = 0; row < HEIGHT; ++row)
+    {
+        for (int col = 0; col < WIDTH; ++col)
+        {
+            const Cell cell = row * WIDTH + col;
+            EXPECT_EQ(cells::ROW[cell], row);
+            EXPECT_EQ(cells::COL[cell], col);
+
+            std::vector<Cell> expected;
+            if (col < WIDTH - 1)
+                expected.push_back(cell + 1);
+            if (row < HEIGHT - 1)
+                expected.push_back(cell + WIDTH);
+            if (col > 0)
+                expected.push_back(cell - 1);
+            if (row > 0)
+                expected.push_back(cell - WIDTH);
+            const auto& nbhs = cells::NEIGHBOURS[cell];
+            EXPECT_EQ(std::vector<Cell>(nbhs.begin(), nbhs.end()), expected) << cell;
+            EXPECT_EQ(cells::has_neighbour(cell, cells::RIGHT), col < WIDTH - 1);
+            EXPECT_EQ(cells::has_neighbour(cell, cells::UP), row > 0);
+        }
+    }
+}
+
+TEST(CellsTest, EachCellAndColorHasItsOwnZobristKey)
+{
+    std::set<Key> keys;
+    for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+    {
+        for (int color = 1; color <= MAX_COLORS; ++color)
+            keys.insert(sg::zobrist::get_key(cell, to_enum<Color>(color)));
+    }
+    EXPECT_EQ(keys.size(), size_t{MAX_CELLS * MAX_COLORS});
+}
+
+TEST(CellsTest, TheZobristKeysDontDependOnTheSeed)
+{
+    const Key before = sg::zobrist::get_key(7, to_enum<Color>(2));
+    const uint64_t seed = Rand::global_seed();
+    Rand::set_global_seed(seed + 1);
+    EXPECT_EQ(sg::zobrist::get_key(7, to_enum<Color>(2)), before);
+    Rand::set_global_seed(seed);
+
+    // Baked into the binary.
+    constexpr sg::zobrist::ZTable table{
+        Rand::derive_seed(Rand::DEFAULT_SEED, Rand::Domain::zobrist)};
+    EXPECT_EQ(table(7, to_enum<Color>(2)), before);
+}
+
+TEST(CellsTest, TheZobristKeysLeaveTheTerminalFlagsFree)
+{
+    for (size_t ndx = 0; ndx < sg::zobrist::Table.size(); ++ndx)
+        EXPECT_EQ(sg::zobrist::Table[ndx] & 3, 0) << ndx;
+}
+
+TEST(CellsTest, TheKeyTellsWhetherTheStateIsTerminal)
+{
+    for (uint64_t ndx = 0; ndx < 20; ++ndx)
+    {
+        const gen::Params params{.n_colors = 1 + int(ndx % MAX_COLORS)};
+        State state = gen::generate(params, 12, ndx);
+        while (true)
+        {
+            state.key();
+            const bool terminal = state.valid_actions_data().empty();
+            ASSERT_EQ(state.is_terminal(), terminal);
+            if (terminal)
+                break;
+            // Both ways of playing have to forget the key.
+            if (ndx % 2)
+                state.apply_random_action();
+            else
+                state.apply_action(state.valid_actions_data().back());
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,273 @@
+#include "board_gen.h"
+#include "clusterhelper.h"
+#include "dsu.h"
+#include "samegame.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace sg;
+
+/** The colors and sizes of the clusters, which don't depend on the reps chosen. */
+std::vector<std::pair<int, int>> colors_and_sizes(const ClusterDataVec& descriptors)
+{
+    std::vector<std::pair<int, int>> ret;
+    for (const auto& cd : descriptors)
+        ret.emplace_back(to_integral(cd.color), cd.size);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+/** Random boards of `n_colors` colors, played down to various fill levels. */
+std::vector<State> boards_of(int n_colors, double clustering = 0.0)
+{
+    std::vector<State> ret;
+    const gen::Params params{.n_colors = n_colors, .clustering = clustering};
+    for (uint64_t ndx = 0; ndx < 10; ++ndx)
+    {
+        State state = gen::generate(params, 11, ndx);
+        ret.push_back(state);
+        while (!state.is_terminal())
+        {
+            state.apply_random_action();
+            ret.push_back(state);
+        }
+    }
+    return ret;
+}
+
+class FewColorsTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(FewColorsTest, FindsTheClustersOfTheDsu)
+{
+    ClusterDataVec expected, actual;
+    for (const State& state : boards_of(GetParam()))
+    {
+        clusters::get_valid_clusters_descriptors(state.grid(), expected);
+        clusters::get_valid_clusters_descriptors(state.grid(), state.color_counter(), actual);
+
+        ASSERT_EQ(colors_and_sizes(actual), colors_and_sizes(expected));
+        for (const auto& cd : actual)
+        {
+            const ClusterData cluster = clusters::get_cluster_data(state.grid(), cd.rep);
+            EXPECT_EQ(cluster.color, cd.color);
+            EXPECT_EQ(cluster.size, cd.size);
+        }
+    }
+}
+
+TEST_P(FewColorsTest, TheRepIsTheSmallestCell)
+{
+    ClusterDataVec actual;
+    for (const State& state : boards_of(GetParam(), 0.5))
+    {
+        clusters::get_valid_clusters_descriptors(state.grid(), state.color_counter(), actual);
+
+        EXPECT_TRUE(std::is_sorted(actual.begin(), actual.end(), [](auto a, auto b) {
+            return a.rep < b.rep;
+        }));
+        for (const auto& cd : actual)
+        {
+            const Cluster cluster = clusters::get_cluster(state.grid(), cd.rep);
+            EXPECT_EQ(*std::min_element(cluster.members.begin(), cluster.members.end()),
+                      cd.rep);
+        }
+    }
+}
+
+TEST_P(FewColorsTest, TheChildrenAreTheStatesTheActionsLeadTo)
+{
+    ClusterDataVec expected, actions;
+    std::vector<State> children;
+    for (const State& state : boards_of(GetParam(), 0.3))
+    {
+        state.valid_actions_data(expected);
+        state.generate_children(actions, children);
+
+        ASSERT_EQ(actions, expected);
+        ASSERT_EQ(children.size(), actions.size());
+        for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+        {
+            State child = state;
+            ASSERT_TRUE(child.apply_action(actions[ndx]));
+            EXPECT_EQ(children[ndx].grid(), child.grid());
+            EXPECT_EQ(children[ndx].color_counter(), child.color_counter());
+            EXPECT_EQ(children[ndx].key(), child.key());
+        }
+    }
+}
+
+TEST_P(FewColorsTest, TheActionsAreIdentifiedByTheirSmallestCell)
+{
+    ClusterDataVec expected, actual;
+    for (const State& state : boards_of(GetParam()))
+    {
+        state.valid_actions_data(expected);
+        clusters::get_valid_clusters_descriptors(state.grid(), actual);
+        EXPECT_EQ(actual, expected);
+
+        // Whatever the cell of the cluster the action is applied to.
+        for (const auto& cd : expected)
+        {
+            const Cluster cluster = clusters::get_cluster(state.grid(), cd.rep);
+            Grid grid = state.grid();
+            EXPECT_EQ(clusters::apply_action(grid, cluster.members.back()), cd);
+            EXPECT_EQ(clusters::get_cluster_data(state.grid(), cluster.members.back()), cd);
+        }
+    }
+}
+
+TEST_P(FewColorsTest, TheDroppedActionsCommuteWithTheLastOne)
+{
+    ClusterDataVec actions, valid, canonical, after;
+    int n_dropped = 0;
+    const auto boards = boards_of(GetParam(), 0.3);
+    // One board in four is enough to meet many commuting actions.
+    for (size_t board = 0; board < boards.size(); board += 4)
+    {
+        State state = boards[board];
+        state.clear_last_action();
+        state.canonical_actions_data(canonical);
+        state.valid_actions_data(actions);
+        ASSERT_EQ(canonical, actions);
+
+        for (const auto& action : actions)
+        {
+            State child = state;
+            child.apply_action(action);
+            child.valid_actions_data(valid);
+            child.canonical_actions_data(canonical);
+            ASSERT_TRUE(std::includes(valid.begin(), valid.end(), canonical.begin(),
+                                      canonical.end(), [](auto a, auto b) {
+                                          return a.rep < b.rep;
+                                      }));
+            for (const auto& dropped : valid)
+            {
+                if (std::find(canonical.begin(), canonical.end(), dropped) != canonical.end())
+                    continue;
+                ++n_dropped;
+                // Played first, it leaves the action on its right for later.
+                ASSERT_NE(std::find(actions.begin(), actions.end(), dropped), actions.end());
+                State expected = child;
+                expected.apply_action(dropped);
+                State first = state;
+                first.apply_action(dropped);
+                first.valid_actions_data(after);
+                EXPECT_TRUE(std::any_of(after.begin(), after.end(), [&](auto other) {
+                    State second = first;
+                    second.apply_action(other);
+                    return other.size == action.size && second == expected;
+                }));
+            }
+        }
+    }
+    // With a single color, the board is a single cluster.
+    if (GetParam() > 1)
+        EXPECT_GT(n_dropped, 0);
+}
+
+TEST_P(FewColorsTest, TheCanonicalChildrenAreThoseOfTheCanonicalActions)
+{
+    ClusterDataVec expected, actions;
+    std::vector<State> children;
+    for (const State& state : boards_of(GetParam(), 0.3))
+    {
+        state.canonical_actions_data(expected);
+        state.generate_canonical_children(actions, children);
+
+        ASSERT_EQ(actions, expected);
+        for (size_t ndx = 0; ndx < actions.size(); ++ndx)
+        {
+            State child = state;
+            child.apply_action(actions[ndx]);
+            EXPECT_EQ(children[ndx].grid(), child.grid());
+            EXPECT_EQ(children[ndx].canonical_key(), child.canonical_key());
+            EXPECT_EQ(child.canonical_key() & 3, child.key() & 3);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Colors, FewColorsTest, ::testing::Range(1, MAX_COLORS + 1));
+
+TEST(FewColorsTest, RemapsTheColorsInUse)
+{
+    // Like data/test5.json, which only uses the last two colors.
+    const gen::Params params{.n_colors = MAX_COLORS, .weights = {0.0, 0.0, 0.0, 1.0, 1.0}};
+    const State state = gen::generate(params, 3, 0);
+    ASSERT_EQ(state.color_counter()[1], 0);
+
+    ClusterDataVec expected, actual;
+    clusters::get_valid_clusters_descriptors(state.grid(), expected);
+    state.valid_actions_data(actual);
+
+    EXPECT_EQ(colors_and_sizes(actual), colors_and_sizes(expected));
+}
+
+TEST(FlatDsuTest, MatchesTheRepresentativesAndSizesOfTheDsu)
+{
+    constexpr int IndexMax = 10;
+    DSU<ClusterT<int, IndexMax + 1>, IndexMax> dsu{};
+    FlatDSU<int, IndexMax> flat_dsu{};
+    const std::vector<std::pair<int, int>> unions{
+        {0, 1}, {3, 4}, {1, 2}, {4, 5}, {5, 6}, {2, 6}, {8, 9}};
+
+    for (auto [a, b] : unions)
+    {
+        dsu.unite(a, b);
+        flat_dsu.unite(a, b);
+    }
+
+    for (int ndx = 0; ndx < IndexMax; ++ndx)
+    {
+        const int rep = flat_dsu.find_rep(ndx);
+        EXPECT_EQ(rep, dsu.find_rep(ndx));
+        EXPECT_EQ(flat_dsu.size(rep), dsu.get_cluster(ndx).size());
+    }
+
+    flat_dsu.reset();
+    for (int ndx = 0; ndx < IndexMax; ++ndx)
+    {
+        EXPECT_TRUE(flat_dsu.is_rep(ndx));
+        EXPECT_EQ(flat_dsu.size(ndx), 1);
+    }
+}
+
+/** A board of the color 0, but for the last cell. */
+std::string board_ending_with(const std::string& last)
+{
+    std::string ret;
+    for (Cell cell = 0; cell < MAX_CELLS - 1; ++cell)
+        ret += (cell % WIDTH ? " 0" : "\n0");
+    return ret + ' ' + last;
+}
+
+TEST(InputTest, ReadsTheColorsInRange)
+{
+    for (const auto& last : {std::string("-1"), std::to_string(MAX_COLORS - 1)})
+    {
+        std::istringstream iss(board_ending_with(last));
+        const State state(iss);
+        EXPECT_FALSE(iss.fail()) << last;
+        EXPECT_EQ(to_integral(state.grid()[MAX_CELLS - 1]), std::stoi(last) + 1);
+    }
+}
+
+TEST(InputTest, FailsOnAColorOutOfRange)
+{
+    for (const auto& last : {std::string("-2"), std::to_string(MAX_COLORS), std::string("15")})
+    {
+        Grid grid{};
+        ColorCounter ccolors{};
+        std::istringstream iss(board_ending_with(last));
+        clusters::input(iss, grid, ccolors);
+        EXPECT_TRUE(iss.fail()) << last;
+        EXPECT_EQ(ccolors[1], MAX_CELLS - 1);
+    }
+}
+
+} // namespace
@@ -0,0 +1,204 @@
+#include "boards.h"
+#include "corpus.h"
+#include "samegame.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace sg;
+using tests::full_grid;
+
+class CorpusTest : public ::testing::Test {
+protected:
+    CorpusTest()
+    {
+        std::istringstream iss{full_grid};
+        board = State(iss);
+    }
+
+    State board;
+};
+
+TEST_F(CorpusTest, CoordinatesRoundTrip)
+{
+    std::vector<ClusterData> actions;
+    State state = board;
+    for (int i = 0; i < 10 && !state.is_terminal(); ++i)
+        actions.push_back(state.apply_random_action());
+
+    std::stringstream ss;
+    corpus::write_coordinates(ss, actions);
+    std::vector<ClusterData> read_actions;
+    ASSERT_TRUE(corpus::read_coordinates(ss, board, read_actions));
+
+    EXPECT_EQ(read_actions.size(), actions.size());
+    EXPECT_EQ(score_sequence(board, read_actions), score_sequence(board, actions));
+}
+
+TEST_F(CorpusTest, TheBottomLeftCellIsTheOrigin)
+{
+    std::ostringstream oss;
+    corpus::write_coordinates(oss, {ClusterData{.rep = CELL_BOTTOM_LEFT}});
+
+    EXPECT_EQ(oss.str(), " 0,0");
+}
+
+TEST_F(CorpusTest, RejectsTheInvalidSequences)
+{
+    std::vector<ClusterData> actions;
+    std::istringstream out_of_the_grid{" 0,0 15,3"};
+    EXPECT_FALSE(corpus::read_coordinates(out_of_the_grid, board, actions));
+    std::istringstream garbage{" 0;0"};
+    EXPECT_FALSE(corpus::read_coordinates(garbage, board, actions));
+}
+
+TEST_F(CorpusTest, ReadsTheBoardOfATestFile)
+{
+    const std::string filename = ::testing::TempDir() + "corpus_tests.json";
+    auto write_test = [&](std::string grid) {
+        for (size_t pos; (pos = grid.find('\n')) != std::string::npos;)
+            grid.replace(pos, 1, "\\n");
+        std::ofstream(filename) << "{\n\t\"testIn\": \"" << grid << "\",\n}\n";
+    };
+
+    State state;
+    write_test(full_grid);
+    ASSERT_TRUE(corpus::read_test(filename, state));
+    EXPECT_EQ(state, board);
+
+    // A color out of range halfway through the board.
+    std::string corrupt = full_grid;
+    corrupt[corrupt.find('\n', corrupt.size() / 2) + 1] = '7';
+    write_test(corrupt);
+    EXPECT_FALSE(corpus::read_test(filename, state));
+    EXPECT_EQ(state, board);
+    std::remove(filename.c_str());
+}
+
+TEST_F(CorpusTest, ReadsSeveralTextBoards)
+{
+    std::istringstream iss{full_grid + "\n\n" + full_grid + full_grid + "\n"};
+    State state;
+    int n_boards = 0;
+    while (corpus::read_text(iss, state))
+    {
+        EXPECT_EQ(state, board);
+        ++n_boards;
+    }
+    EXPECT_EQ(n_boards, 3);
+}
+
+TEST_F(CorpusTest, PackUnpack)
+{
+    State state = board;
+    for (int i = 0; i < 30 && !state.is_terminal(); ++i)
+    {
+        uint8_t packed[corpus::BinaryHeader::BOARD_BYTES];
+        corpus::pack(state.grid(), packed);
+        const State unpacked = corpus::unpack(packed);
+
+        EXPECT_EQ(unpacked, state);
+        EXPECT_EQ(unpacked.color_counter(), state.color_counter());
+        // A hint, which the search only updates lazily.
+        EXPECT_GE(unpacked.grid().n_empty_rows, state.grid().n_empty_rows);
+        state.apply_random_action();
+    }
+}
+
+TEST_F(CorpusTest, MappedCorpusReadsTheBoardsWritten)
+{
+    const std::string filename = ::testing::TempDir() + "corpus_tests.sgc";
+    std::vector<State> boards;
+    State state = board;
+    while (!state.is_terminal())
+    {
+        boards.push_back(state);
+        state.apply_random_action();
+    }
+    corpus::BinaryWriter writer;
+    ASSERT_TRUE(writer.open(filename));
+    for (const auto& b : boards)
+        writer.add(b);
+    ASSERT_TRUE(writer.close());
+
+    corpus::MappedCorpus mapped;
+    ASSERT_TRUE(mapped.open(filename)) << mapped.error();
+    ASSERT_EQ(mapped.size(), boards.size());
+    size_t i = 0;
+    for (State read : mapped)
+        EXPECT_EQ(read, boards[i++]);
+    EXPECT_EQ(i, boards.size());
+    EXPECT_EQ(mapped[3], boards[3]);
+
+    // Moving it keeps the mapping.
+    corpus::MappedCorpus moved = std::move(mapped);
+    EXPECT_EQ(moved.size(), boards.size());
+    EXPECT_EQ(moved[0], boards[0]);
+    std::remove(filename.c_str());
+}
+
+TEST_F(CorpusTest, MappedCorpusChecksTheFile)
+{
+    const std::string filename = ::testing::TempDir() + "corpus_tests_invalid.sgc";
+    corpus::MappedCorpus mapped;
+    EXPECT_FALSE(mapped.open(filename + ".missing"));
+
+    std::ofstream(filename) << full_grid;
+    EXPECT_FALSE(mapped.open(filename));
+    EXPECT_NE(mapped.error().find("not a binary corpus"), std::string::npos);
+
+    // A header announcing more boards than the file holds.
+    auto header = corpus::BinaryHeader::current(2);
+    uint8_t packed[corpus::BinaryHeader::BOARD_BYTES];
+    corpus::pack(board.grid(), packed);
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(packed), sizeof(packed));
+    }
+    EXPECT_FALSE(mapped.open(filename));
+    EXPECT_NE(mapped.error().find("truncated"), std::string::npos);
+
+    header.width = WIDTH + 1;
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    EXPECT_FALSE(mapped.open(filename));
+    EXPECT_EQ(mapped.size(), 0);
+    std::remove(filename.c_str());
+}
+
+TEST_F(CorpusTest, MappedCorpusRejectsTheColorsOutOfRange)
+{
+    const std::string filename = ::testing::TempDir() + "corpus_tests_corrupt.sgc";
+    uint8_t packed[corpus::BinaryHeader::BOARD_BYTES];
+    corpus::pack(board.grid(), packed);
+    EXPECT_TRUE(corpus::is_valid_packed(packed));
+    uint8_t corrupt[corpus::BinaryHeader::BOARD_BYTES];
+    std::fill(std::begin(corrupt), std::end(corrupt), 0xff);
+    EXPECT_FALSE(corpus::is_valid_packed(corrupt));
+
+    // The corrupt board comes second.
+    const auto header = corpus::BinaryHeader::current(3);
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(packed), sizeof(packed));
+        ofs.write(reinterpret_cast<const char*>(corrupt), sizeof(corrupt));
+        ofs.write(reinterpret_cast<const char*>(packed), sizeof(packed));
+    }
+    corpus::MappedCorpus mapped;
+    EXPECT_FALSE(mapped.open(filename));
+    EXPECT_NE(mapped.error().find("board 1"), std::string::npos) << mapped.error();
+    EXPECT_EQ(mapped.size(), 0);
+    std::remove(filename.c_str());
+}
+
+} // namespace
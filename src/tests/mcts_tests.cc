@@ -0,0 +1,399 @@
+#include "board_gen.h"
+#include "boards.h"
+#include "samegame.h"
+#include "mcts.h"
+#include "rand.h"
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace mcts {
+
+namespace {
+
+using namespace sg;
+using tests::full_grid;
+
+/**
+ * A small endgame position: three rows of seven cells at the bottom of the grid.
+ */
+const std::string small_grid = []() {
+  std::string ret{};
+  for (int row = 0; row < HEIGHT - 3; ++row)
+  {
+    for (int col = 0; col < WIDTH; ++col)
+      ret += "-1 ";
+    ret += '\n';
+  }
+  ret += "0 2 2 0 1 2 1 -1 -1 -1 -1 -1 -1 -1 -1\n"
+         "1 2 2 0 2 0 0 -1 -1 -1 -1 -1 -1 -1 -1\n"
+         "1 1 2 0 0 2 1 -1 -1 -1 -1 -1 -1 -1 -1\n";
+  return ret;
+}();
+
+/** Brute force search of the best score reachable from a state. */
+double exhaustive_search(const State& state)
+{
+  auto actions = state.valid_actions_data();
+  if (actions.empty())
+    return state.evaluate_terminal();
+
+  double best = 0.0;
+  for (const auto& a : actions)
+  {
+    State child = state;
+    child.apply_action(a);
+    best = std::max(best, state.evaluate(a) + exhaustive_search(child));
+  }
+  return best;
+}
+
+double sequence_value(State state, const std::vector<ClusterData>& actions)
+{
+  double ret = 0.0;
+  for (const auto& a : actions)
+  {
+    ret += state.evaluate(state.get_cd(a.rep));
+    state.apply_action(a);
+  }
+  return ret + state.evaluate_terminal();
+}
+
+class MctsTest : public ::testing::Test {
+protected:
+    using MctsAgent = Mcts<State, ClusterData>;
+
+    MctsTest()
+    {
+        std::istringstream iss{small_grid};
+        state = State(iss);
+    }
+
+    State state;
+};
+
+TEST_F(MctsTest, SolverStopsOnceTheTreeIsSolved)
+{
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_iterations(100000);
+    mcts.set_max_time(0);
+
+    mcts.best_action_sequence();
+
+    EXPECT_THAT(mcts.get_iterations_cnt(), ::testing::Lt(100000));
+}
+
+TEST_F(MctsTest, SolvedTreeYieldsTheOptimalSequence)
+{
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_iterations(100000);
+    mcts.set_max_time(0);
+
+    auto actions = mcts.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
+
+    EXPECT_DOUBLE_EQ(sequence_value(state, actions), exhaustive_search(state));
+}
+
+TEST_F(MctsTest, ProgressiveExpansionSolvesTheTreeToo)
+{
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_iterations(100000);
+    mcts.set_max_time(0);
+    mcts.set_expansion_strategy(MctsAgent::ExpansionStrategy::progressive);
+
+    auto actions = mcts.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
+
+    EXPECT_THAT(mcts.get_iterations_cnt(), ::testing::Lt(100000));
+    EXPECT_DOUBLE_EQ(sequence_value(state, actions), exhaustive_search(state));
+}
+
+TEST_F(MctsTest, CanonicalOrderSolvesTheTreeInFewerIterations)
+{
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_iterations(100000);
+    mcts.set_max_time(0);
+    mcts.best_action_sequence();
+
+    State canonical_state = state;
+    MctsAgent canonical(canonical_state);
+    canonical.set_max_iterations(100000);
+    canonical.set_max_time(0);
+    canonical.set_canonical_order(true);
+    auto actions = canonical.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
+
+    EXPECT_DOUBLE_EQ(sequence_value(state, actions), exhaustive_search(state));
+    EXPECT_THAT(canonical.get_iterations_cnt(), ::testing::Lt(mcts.get_iterations_cnt()));
+}
+
+TEST(HybridPlayoutTest, CanonicalOrderFindsTheSameValues)
+{
+    // Deep enough to search the whole endgames.
+    using Solver = policies::Hybrid_Playout_Func<State, ClusterData, 0, 0, 32>;
+    using CanonicalSolver = policies::
+        Hybrid_Playout_Func<State, ClusterData, 0, 0, 32,
+                            policies::Default_Playout_Func<State, ClusterData>, true>;
+    for (uint64_t ndx = 0; ndx < 10; ++ndx)
+    {
+        const gen::Params params{.width = 6, .height = 4, .n_colors = 3};
+        State plain = gen::generate(params, 3, ndx);
+        State canonical = plain;
+        EXPECT_DOUBLE_EQ(CanonicalSolver::solve(canonical, 0).value,
+                         Solver::solve(plain, 0).value);
+    }
+}
+
+TEST(HybridPlayoutTest, DoesNotReuseTheEstimatesOfTheHorizon)
+{
+    using Solver = policies::Hybrid_Playout_Func<State, ClusterData, 0, 0, 2>;
+    const gen::Params params{.width = 6, .height = 4, .n_colors = 3};
+    for (uint64_t ndx = 0; ndx < 10; ++ndx)
+    {
+        const State state = gen::generate(params, 9, ndx);
+        if (state.is_terminal())
+            continue;
+        // Met at the horizon first, estimated without any action to play.
+        State at_horizon = state;
+        EXPECT_TRUE(state.is_trivial(Solver::solve(at_horizon, 2).action));
+
+        State at_root = state;
+        const auto entry = Solver::solve(at_root, 0);
+        EXPECT_FALSE(state.is_trivial(entry.action));
+        EXPECT_GE(entry.horizon, 2);
+    }
+}
+
+TEST(BestLineTest, IsReturnedWhenItBeatsTheTraversal)
+{
+    const gen::Params params{};
+    int n_returned = 0;
+    for (uint64_t ndx = 0; ndx < 5; ++ndx)
+    {
+        const State state = gen::generate(params, 13, ndx);
+        State _state = state;
+        Mcts<State, ClusterData> mcts(_state);
+        mcts.set_max_iterations(2);
+        mcts.set_max_time(0);
+        mcts.run();
+
+        // The tree only holds the first actions, the line goes to the end of the game.
+        const auto [line, value] = mcts.get_best_line();
+        ASSERT_FALSE(line.empty());
+        EXPECT_DOUBLE_EQ(value, sequence_value(state, line));
+        State end = state;
+        for (const auto& action : line)
+            end.apply_action(action);
+        EXPECT_TRUE(end.is_terminal());
+
+        // Otherwise the traversal, finished at random, did at least as well.
+        const auto sequence = mcts.peek_best_sequence();
+        if (sequence == line)
+            ++n_returned;
+        else
+            EXPECT_GE(sequence_value(state, sequence), value);
+    }
+    EXPECT_GT(n_returned, 0);
+}
+
+using ActionSelection = Mcts<State, ClusterData>::ActionSelection;
+
+/**
+ * Play an action at the root of a search of `board`, the first one of the best
+ * sequence or the most visited one, and check what becomes of the best line.
+ *
+ * @Return Whether the action played started the line.
+ */
+bool play_and_check_the_line(const State& board, bool first_of_sequence)
+{
+    State state = board;
+    Mcts<State, ClusterData> mcts(state);
+    mcts.set_max_iterations(20);
+    mcts.set_max_time(0);
+    mcts.run();
+    const auto [line, value] = mcts.get_best_line();
+    EXPECT_FALSE(line.empty());
+
+    // Stopped at once, so that no playout records another line.
+    const std::atomic<bool> stop{true};
+    mcts.set_stop_flag(&stop);
+    const ClusterData action = first_of_sequence
+                                   ? mcts.best_sequence_action()
+                                   : mcts.best_action(ActionSelection::by_n_visits);
+    const auto [after, after_value] = mcts.get_best_line();
+    if (!line.empty() && action == line.front())
+    {
+        EXPECT_EQ(after, std::vector<ClusterData>(line.begin() + 1, line.end()));
+        EXPECT_DOUBLE_EQ(after_value, value - board.evaluate(action));
+        return true;
+    }
+    EXPECT_TRUE(after.empty());
+    EXPECT_EQ(after_value, std::numeric_limits<double>::lowest());
+    return false;
+}
+
+TEST(BestLineTest, FollowsTheActionsPlayedAtTheRoot)
+{
+    const gen::Params params{.n_colors = 3};
+    int n_shifted = 0, n_cleared = 0;
+    for (uint64_t ndx = 0; ndx < 10; ++ndx)
+    {
+        // The line beats the tree, so it starts the best sequence. The most visited
+        // action seldom starts it.
+        const State board = gen::generate(params, 14, ndx);
+        for (bool first_of_sequence : {true, false})
+            ++(play_and_check_the_line(board, first_of_sequence) ? n_shifted : n_cleared);
+    }
+    EXPECT_GT(n_shifted, 0);
+    EXPECT_GT(n_cleared, 0);
+}
+
+TEST_F(MctsTest, MemoryUsageCoversTheWholeTree)
+{
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_iterations(100);
+    mcts.set_max_time(0);
+
+    mcts.best_action_sequence();
+    const auto memory = mcts.get_memory_usage();
+
+    EXPECT_EQ(memory.n_nodes, mcts.get_n_nodes());
+    EXPECT_GT(memory.n_edges, 0);
+    EXPECT_GE(memory.bytes_per_node(), 4 * sizeof(int));
+    EXPECT_GE(memory.bytes_per_edge(), sizeof(ClusterData) + 2 * sizeof(float) + sizeof(int));
+}
+
+TEST_F(MctsTest, BuffersGrowPastTheInitialDepth)
+{
+    std::istringstream iss{full_grid};
+    const State full(iss);
+    State _state = full;
+    Mcts<State, ClusterData, policies::Default_UCB_Func,
+         policies::Default_Playout_Func<State, ClusterData>, 2>
+        mcts(_state);
+    mcts.set_max_iterations(300);
+    mcts.set_max_time(0);
+
+    auto actions = mcts.best_action_sequence();
+
+    EXPECT_GT(actions.size(), 2);
+    State replay = full;
+    for (const auto& a : actions)
+    {
+        ASSERT_GE(replay.get_cd(a.rep).size, 2);
+        replay.apply_action(a);
+    }
+    EXPECT_TRUE(replay.is_terminal());
+}
+
+TEST_F(MctsTest, StatsCountEveryPhaseOfEveryIteration)
+{
+    if constexpr (!instrument::enabled)
+        GTEST_SKIP() << "Compiled without SG_INSTRUMENT";
+
+    State _state = state;
+    MctsAgent mcts(_state);
+    mcts.set_max_iterations(50);
+    mcts.set_max_time(0);
+    mcts.best_action_sequence();
+    const auto& stats = mcts.get_stats();
+
+    EXPECT_EQ(stats.select_leaf.calls, mcts.get_iterations_cnt());
+    EXPECT_EQ(stats.expand_current_node.calls, mcts.get_iterations_cnt());
+    EXPECT_EQ(stats.backpropagate.calls, mcts.get_iterations_cnt());
+    EXPECT_EQ(stats.selection_depth.samples, mcts.get_iterations_cnt());
+    EXPECT_EQ(stats.playout_length.samples, stats.simulate_playout.calls);
+    EXPECT_GE(stats.expand_current_node.total_ns, stats.simulate_playout.total_ns);
+}
+
+TEST(ReproducibilityTest, SameSeedGivesTheSameSearch)
+{
+    using MctsAgent = Mcts<State, ClusterData>;
+    auto search = []() {
+        std::istringstream iss{full_grid};
+        State state(iss);
+        MctsAgent mcts(state);
+        mcts.set_max_iterations(300);
+        mcts.set_max_time(0);
+        auto actions = mcts.best_action_sequence(MctsAgent::ActionSelection::by_n_visits);
+        return std::make_pair(actions, mcts.get_n_nodes());
+    };
+    const auto seed = Rand::global_seed();
+
+    Rand::set_global_seed(seed);
+    const auto first = search();
+    Rand::set_global_seed(seed);
+    const auto second = search();
+
+    EXPECT_EQ(first, second);
+}
+
+TEST(ReproducibilityTest, PlayoutsFollowTheGlobalSeed)
+{
+    auto playout = [](uint64_t seed) {
+        Rand::set_global_seed(seed);
+        std::istringstream iss{full_grid};
+        State state(iss);
+        std::vector<ClusterData> ret{};
+        while (!state.is_terminal())
+            ret.push_back(state.apply_random_action());
+        return ret;
+    };
+
+    EXPECT_EQ(playout(1), playout(1));
+    EXPECT_NE(playout(1), playout(2));
+}
+
+TEST(UcbSelectionTest, BatchedSelectionMatchesPerEdgeSelection)
+{
+    // A functor only providing the per-edge function.
+    struct PerEdge_UCB_Func
+    {
+        auto operator()(double expl_cst, unsigned int n_parent_visits)
+        {
+            return policies::Default_UCB_Func{}(expl_cst, n_parent_visits);
+        }
+    };
+    std::mt19937 gen{42};
+    std::uniform_real_distribution<float> value_dist(0.0, 3.0);
+    std::uniform_int_distribution<int> visits_dist(0, 50);
+
+    for (int n = 1; n < 40; ++n)
+    {
+        std::vector<ClusterData> actions(n);
+        std::vector<float> avg_val(n), best_val(n);
+        std::vector<int> n_visits(n);
+        std::vector<uint8_t> completed(n);
+        for (int i = 0; i < n; ++i)
+        {
+            avg_val[i] = value_dist(gen);
+            best_val[i] = avg_val[i];
+            n_visits[i] = visits_dist(gen);
+            completed[i] = i % 7 == 3;
+        }
+        policies::EdgeBatch<ClusterData, float> batch{actions.data(),
+                                                      avg_val.data(),
+                                                      best_val.data(),
+                                                      n_visits.data(),
+                                                      completed.data(),
+                                                      size_t(n)};
+        policies::Default_UCB_Func batched{};
+        PerEdge_UCB_Func per_edge{};
+
+        EXPECT_EQ(policies::select_ucb(batched, 0.7, 200, batch),
+                  policies::select_ucb(per_edge, 0.7, 200, batch));
+    }
+}
+
+} // namespace
+} // namespace mcts
@@ -3,8 +3,12 @@
 #include "gmock/gmock.h"
 #include "spdlog/spdlog.h"
 #include "rand.h"
+#include <algorithm>
+#include <array>
 #include <map>
+#include <numeric>
 #include <utility>
+#include <vector>
 
 namespace Rand {
 
@@ -24,6 +28,17 @@ auto counter(const std::multimap<IntT, int>& mmap) {
     return ret;
 }
 
+/** Pearson's statistic of the observed counts against a uniform distribution. */
+double chi_square(const std::vector<int>& observed)
+{
+    const double n = std::accumulate(observed.begin(), observed.end(), 0.0);
+    const double expected = n / observed.size();
+    double ret = 0.0;
+    for (const int o : observed)
+        ret += (o - expected) * (o - expected) / expected;
+    return ret;
+}
+
 class RandUtilTest : public ::testing::Test {
 protected:
     RandUtilTest()
@@ -106,8 +121,118 @@ TEST_F(RandUtilTest, NumberOfCollisionsAsExpected64Bit)
     EXPECT_THAT(biggest_clash->second, ::testing::Eq(1));
 }
 
+// Critical values of the chi-square distribution at p = 0.001.
+constexpr double CHI2_14_DOF = 36.12;
+constexpr double CHI2_224_DOF = 304.94;
+
+TEST_F(RandUtilTest, BoundedIntegersAreUniform)
+{
+    Util<int> rand_util {42};
+    std::vector<int> counts(15, 0);
+
+    for (int i=0; i<150000; ++i) {
+        ++counts[rand_util.get(0, 14)];
+    }
+
+    EXPECT_THAT(chi_square(counts), ::testing::Lt(CHI2_14_DOF));
+}
+
+TEST_F(RandUtilTest, FilledIntegersAreUniformAndInRange)
+{
+    Util<int> rand_util {42};
+    std::vector<int> values(225000);
+    rand_util.fill(values.begin(), values.end(), -100, 124);
+
+    std::vector<int> counts(225, 0);
+    for (const int v : values) {
+        ASSERT_THAT(v, ::testing::AllOf(::testing::Ge(-100), ::testing::Le(124)));
+        ++counts[v + 100];
+    }
+
+    EXPECT_THAT(chi_square(counts), ::testing::Lt(CHI2_224_DOF));
+}
+
+TEST_F(RandUtilTest, ShuffleIsUniformOverPositions)
+{
+    constexpr int N = 15;
+    Util<int> rand_util {42};
+    // counts[value * N + position]
+    std::vector<std::vector<int>> counts(N, std::vector<int>(N, 0));
+
+    for (int i=0; i<30000; ++i) {
+        std::array<int, N> arr {};
+        std::iota(arr.begin(), arr.end(), 0);
+        rand_util.shuffle<N>(arr, N);
+        for (int pos=0; pos<N; ++pos) {
+            ++counts[arr[pos]][pos];
+        }
+    }
+
+    for (const auto& value_counts : counts) {
+        EXPECT_THAT(chi_square(value_counts), ::testing::Lt(CHI2_14_DOF));
+    }
+}
 
+TEST_F(RandUtilTest, OrderingIsAPermutationOfTheRange)
+{
+    Util<int> rand_util {42};
 
+    for (int beg=0; beg<15; ++beg) {
+        auto ordering = rand_util.gen_ordering<15>(beg, 15);
+        std::sort(ordering.begin(), ordering.begin() + 15 - beg);
+        for (int i=0; i<15-beg; ++i) {
+            EXPECT_EQ(ordering[i], beg + i);
+        }
+    }
+}
+
+TEST_F(RandUtilTest, SameSeedGivesTheSameSequence)
+{
+    Util<uint64_t> a {7}, b {7};
+
+    for (int i=0; i<100; ++i) {
+        EXPECT_EQ(a.get(0, 1000), b.get(0, 1000));
+    }
+}
+
+TEST_F(RandUtilTest, StreamsAreIndependent)
+{
+    using Int_T = uint64_t;
+    Util<Int_T> stream0 {7, 0}, stream1 {7, 1}, stream2 {7, 2};
+    std::multimap<Int_T, int> buckets;
+
+    for (int i=0; i<1000; ++i) {
+        buckets.insert({ stream0.get(LIMIT<Int_T>::MIN, LIMIT<Int_T>::MAX), i });
+        buckets.insert({ stream1.get(LIMIT<Int_T>::MIN, LIMIT<Int_T>::MAX), i });
+        buckets.insert({ stream2.get(LIMIT<Int_T>::MIN, LIMIT<Int_T>::MAX), i });
+    }
+
+    // The low bit of the streams should not be correlated either.
+    std::vector<int> pairs(4, 0);
+    for (int i=0; i<40000; ++i) {
+        ++pairs[2 * stream0.get(0, 1) + stream1.get(0, 1)];
+    }
+
+    EXPECT_THAT(counter(buckets).size(), ::testing::Eq(3000));
+    EXPECT_THAT(chi_square(pairs), ::testing::Lt(16.27)); // 3 dof, p = 0.001
+}
+
+TEST_F(RandUtilTest, ThreadUtilFollowsTheGlobalSeed)
+{
+    auto draw = []() {
+        auto& util = thread_util<int, Domain::search>();
+        std::vector<int> ret(20);
+        util.fill(ret.begin(), ret.end(), 0, 1000);
+        return ret;
+    };
+
+    set_global_seed(3);
+    const auto first = draw();
+    set_global_seed(3);
+    EXPECT_EQ(draw(), first);
+    set_global_seed(4);
+    EXPECT_NE(draw(), first);
+}
 
 } // namespace
 } // namespace Rand
@@ -0,0 +1,136 @@
+#include "board_gen.h"
+#include "clusterhelper.h"
+#include "region_graph.h"
+#include "samegame.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace sg;
+
+using RegionKey = std::tuple<int, int, int, int, int>;
+
+/** The regions of the graph, by their rep: they don't depend on the ids. */
+std::vector<RegionKey> regions_of(const RegionGraph& graph)
+{
+    std::vector<RegionKey> ret;
+    for (size_t id = 0; id < graph.id_end(); ++id)
+    {
+        const auto& region = graph.region(id);
+        if (region.alive())
+            ret.emplace_back(region.rep, to_integral(region.color), region.size,
+                             region.col_min, region.col_max);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+/** The edges of the graph, as pairs of reps. */
+std::set<std::pair<int, int>> edges_of(const RegionGraph& graph)
+{
+    std::set<std::pair<int, int>> ret;
+    for (size_t id = 0; id < graph.id_end(); ++id)
+    {
+        if (!graph.region(id).alive())
+            continue;
+        graph.for_each_neighbour(id, [&](auto other) {
+            ret.emplace(graph.region(id).rep, graph.region(other).rep);
+        });
+    }
+    return ret;
+}
+
+/** The graph is the one built from scratch for its grid, and the labels agree. */
+void expect_consistent(const RegionGraph& graph)
+{
+    const RegionGraph rebuilt(graph.grid());
+    EXPECT_EQ(regions_of(graph), regions_of(rebuilt));
+    EXPECT_EQ(edges_of(graph), edges_of(rebuilt));
+    EXPECT_EQ(graph.n_regions(), rebuilt.n_regions());
+    EXPECT_EQ(graph.grid().n_empty_rows, rebuilt.grid().n_empty_rows);
+    for (Cell cell = 0; cell < MAX_CELLS; ++cell)
+    {
+        const auto id = graph.region_of(cell);
+        if (graph.grid()[cell] == Color::Empty)
+            EXPECT_EQ(id, RegionGraph::REGION_NONE);
+        else
+            EXPECT_EQ(graph.region(id).rep, rebuilt.region(rebuilt.region_of(cell)).rep);
+    }
+}
+
+TEST(RegionGraphTest, TheValidActionsAreTheClusters)
+{
+    for (uint64_t ndx = 0; ndx < 10; ++ndx)
+    {
+        const gen::Params params{.n_colors = 1 + int(ndx % MAX_COLORS)};
+        const State state = gen::generate(params, 2, ndx);
+        const RegionGraph graph(state.grid());
+
+        ClusterDataVec expected, actual;
+        state.valid_actions_data(expected);
+        graph.valid_actions(actual);
+        auto by_rep = [](auto a, auto b) { return a.rep < b.rep; };
+        std::sort(actual.begin(), actual.end(), by_rep);
+        EXPECT_EQ(actual, expected);
+        EXPECT_EQ(graph.is_terminal(), state.is_terminal());
+    }
+}
+
+TEST(RegionGraphTest, StaysInSyncWithTheGrid)
+{
+    for (uint64_t ndx = 0; ndx < 20; ++ndx)
+    {
+        const gen::Params params{.n_colors = 2 + int(ndx % 4), .clustering = 0.3};
+        State state = gen::generate(params, 4, ndx);
+        RegionGraph graph(state.grid());
+        ClusterDataVec actions;
+        for (size_t n_moves = 0; !graph.is_terminal(); ++n_moves)
+        {
+            // Actions all over the board, in the order of the ids.
+            graph.valid_actions(actions);
+            const ClusterData action = actions[(ndx + 7 * n_moves) % actions.size()];
+            ASSERT_EQ(graph.apply_action(graph.region_of(action.rep)), action);
+            ASSERT_TRUE(state.apply_action(action));
+            ASSERT_EQ(graph.grid(), state.grid());
+            expect_consistent(graph);
+        }
+        EXPECT_TRUE(state.is_terminal());
+    }
+}
+
+TEST(RegionGraphTest, LeavesTheGraphAloneOnInvalidActions)
+{
+    const State state = gen::generate(gen::Params{}, 6, 0);
+    RegionGraph graph(state.grid());
+    Cell single = 0;
+    while (graph.region(graph.region_of(single)).size != 1)
+        ++single;
+
+    EXPECT_EQ(graph.apply_action(graph.region_of(single)).size, 1);
+    EXPECT_EQ(graph.grid(), state.grid());
+    expect_consistent(graph);
+}
+
+TEST(RegionGraphTest, MergePotentialCountsTheSameColorTwoEdgesAway)
+{
+    // On the bottom row: 1 2 1 1 3 1, and a 1 above the 2.
+    Grid grid{};
+    const int colors[] = {1, 2, 1, 1, 3, 1};
+    for (int col = 0; col < 6; ++col)
+        grid[CELL_BOTTOM_LEFT + col] = to_enum<Color>(colors[col]);
+    grid[CELL_BOTTOM_LEFT - WIDTH + 1] = to_enum<Color>(1);
+    const RegionGraph graph(grid);
+
+    // The 1 on the left may merge with the one above the 2 and the pair on its right.
+    EXPECT_EQ(graph.merge_potential(graph.region_of(CELL_BOTTOM_LEFT)), 3);
+    // The pair with the 1 on the left, the one above the 2 and the one on the right.
+    EXPECT_EQ(graph.merge_potential(graph.region_of(CELL_BOTTOM_LEFT + 2)), 3);
+    EXPECT_EQ(graph.merge_potential(graph.region_of(CELL_BOTTOM_LEFT + 4)), 0);
+}
+
+} // namespace
@@ -0,0 +1,169 @@
+#include "boards.h"
+#include "samegame.h"
+#include "solve_service.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace sg;
+using tests::full_grid;
+
+TEST(LatencyWindowTest, Quantiles)
+{
+    LatencyWindow window{};
+    EXPECT_EQ(window.quantile(0.5), 0.0);
+    for (int i = 1; i <= 100; ++i)
+        window.add(i);
+
+    EXPECT_EQ(window.quantile(0.0), 1.0);
+    EXPECT_EQ(window.quantile(0.5), 51.0);
+    EXPECT_EQ(window.quantile(0.99), 100.0);
+    EXPECT_EQ(window.quantile(1.0), 100.0);
+}
+
+TEST(LatencyWindowTest, KeepsTheLastLatencies)
+{
+    LatencyWindow window{10};
+    for (int i = 1; i <= 100; ++i)
+        window.add(i);
+
+    EXPECT_EQ(window.size(), 10);
+    EXPECT_EQ(window.quantile(0.0), 91.0);
+    EXPECT_EQ(window.quantile(1.0), 100.0);
+}
+
+/** The rows of `full_grid`. */
+std::vector<std::string> full_rows()
+{
+    std::vector<std::string> ret;
+    std::istringstream iss{full_grid};
+    for (std::string line; std::getline(iss, line);)
+        ret.push_back(line);
+    return ret;
+}
+
+TEST(ParseBoardTest, ReadsAWellFormedBoard)
+{
+    std::istringstream iss{full_grid};
+    const State expected(iss);
+    State board;
+    ASSERT_TRUE(parse_board(full_rows(), board));
+    EXPECT_EQ(board.grid(), expected.grid());
+    EXPECT_EQ(board.color_counter(), expected.color_counter());
+}
+
+TEST(ParseBoardTest, RejectsAMalformedBoard)
+{
+    const State empty;
+    auto expect_rejected = [&](const std::vector<std::string>& rows, const char* what) {
+        State board;
+        EXPECT_FALSE(parse_board(rows, board)) << what;
+        EXPECT_EQ(board.grid(), empty.grid()) << what;
+    };
+
+    auto rows = full_rows();
+    rows.pop_back();
+    expect_rejected(rows, "a missing row");
+
+    rows = full_rows();
+    rows[3] = rows[3].substr(0, rows[3].rfind(' ', rows[3].size() - 2));
+    expect_rejected(rows, "a short row");
+
+    rows = full_rows();
+    rows[3] += " 0";
+    expect_rejected(rows, "a long row");
+
+    rows = full_rows();
+    rows[3].replace(0, 1, std::to_string(MAX_COLORS));
+    expect_rejected(rows, "a color out of range");
+
+    rows = full_rows();
+    rows[3].replace(0, 1, "-2");
+    expect_rejected(rows, "a negative color");
+
+    rows = full_rows();
+    rows[3] = "solve 1 100";
+    expect_rejected(rows, "a request");
+}
+
+class SolveServiceTest : public ::testing::Test {
+protected:
+    SolveServiceTest()
+    {
+        std::istringstream iss{full_grid};
+        board = State(iss);
+    }
+
+    /** Collects the reports of the requests, by request. */
+    SolveService::Callback record(int id)
+    {
+        return [this, id](const SolveService::Progress& progress) {
+            std::lock_guard lock(mutex);
+            reports[id].push_back(progress);
+        };
+    }
+
+    State board;
+    std::mutex mutex;
+    std::map<int, std::vector<SolveService::Progress>> reports;
+};
+
+TEST_F(SolveServiceTest, AnswersEveryRequestWithAValidSequence)
+{
+    SolveService service(SolveService::Config{.n_workers = 2, .progress_ms = 10});
+    for (int id = 0; id < 3; ++id)
+        service.submit(SolveService::Request{board, 30}, record(id));
+    service.wait_idle();
+
+    ASSERT_EQ(reports.size(), 3);
+    for (const auto& [id, progresses] : reports)
+    {
+        const auto& result = progresses.back();
+        EXPECT_TRUE(result.done) << "request " << id;
+        EXPECT_GE(result.score, 0);
+        EXPECT_EQ(result.score, score_sequence(board, result.actions));
+        EXPECT_GT(result.iterations, 0);
+    }
+
+    const auto stats = service.stats();
+    EXPECT_EQ(stats.queue_depth, 0);
+    EXPECT_EQ(stats.running, 0);
+    EXPECT_EQ(stats.completed, 3);
+    EXPECT_GE(stats.latency_p50_ms, 30.0);
+    EXPECT_GE(stats.latency_max_ms, stats.latency_p50_ms);
+}
+
+TEST_F(SolveServiceTest, StreamsTheImprovementsBeforeTheResult)
+{
+    SolveService service(SolveService::Config{.n_workers = 1, .progress_ms = 5});
+    service.submit(SolveService::Request{board, 100}, record(0));
+    service.wait_idle();
+
+    const auto& progresses = reports[0];
+    ASSERT_GE(progresses.size(), 2);
+    for (size_t i = 0; i + 1 < progresses.size(); ++i)
+    {
+        EXPECT_FALSE(progresses[i].done);
+        EXPECT_LE(progresses[i].score, progresses[i + 1].score);
+        EXPECT_LE(progresses[i].iterations, progresses[i + 1].iterations);
+    }
+    EXPECT_TRUE(progresses.back().done);
+}
+
+TEST_F(SolveServiceTest, QueuesTheRequestsBeyondTheWorkers)
+{
+    SolveService service(SolveService::Config{.n_workers = 1});
+    service.submit(SolveService::Request{board, 50}, record(0));
+    service.submit(SolveService::Request{board, 10}, record(1));
+    service.wait_idle();
+
+    // The second request waited for the first one.
+    EXPECT_GE(reports[1].back().queue_ms, 40.0);
+}
+
+} // namespace
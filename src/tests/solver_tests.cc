@@ -0,0 +1,94 @@
+#include "boards.h"
+#include "samegame.h"
+#include "solver.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+using namespace sg;
+using tests::full_grid;
+
+class SolverTest : public ::testing::Test {
+protected:
+    SolverTest()
+    {
+        std::istringstream iss{full_grid};
+        board = State(iss);
+    }
+
+    State board;
+    Solver solver;
+};
+
+TEST_F(SolverTest, PlaysAValidAction)
+{
+    const ClusterData action = solver.play(board, 20);
+
+    EXPECT_FALSE(board.is_trivial(action));
+    EXPECT_EQ(board.get_cd(action.rep), action);
+    EXPECT_FALSE(solver.last_turn().tree_reused);
+    EXPECT_GT(solver.last_turn().iterations, 0);
+}
+
+TEST_F(SolverTest, KeepsTheTreeWhenTheBoardIsTheExpectedOne)
+{
+    board.apply_action(solver.play(board, 20));
+    const auto first_turn = solver.last_turn();
+    board.apply_action(solver.play(board, 20));
+
+    EXPECT_TRUE(solver.last_turn().tree_reused);
+    EXPECT_GT(solver.last_turn().inherited_visits, 0);
+    EXPECT_GT(solver.last_turn().reuse_rate(), 0.0);
+    EXPECT_GE(solver.last_turn().n_nodes, first_turn.n_nodes);
+}
+
+TEST_F(SolverTest, StartsOverOnAnUnexpectedBoard)
+{
+    const ClusterData played = solver.play(board, 20);
+    State expected = board;
+    expected.apply_action(played);
+    // Any other action than the one played.
+    State other = board;
+    for (const auto& action : board.valid_actions_data())
+    {
+        other = board;
+        other.apply_action(action);
+        if (!(other.grid() == expected.grid()))
+            break;
+    }
+    ASSERT_FALSE(other.grid() == expected.grid());
+    solver.play(other, 20);
+
+    EXPECT_FALSE(solver.last_turn().tree_reused);
+    EXPECT_EQ(solver.last_turn().inherited_visits, 0);
+    EXPECT_EQ(solver.last_turn().reuse_rate(), 0.0);
+}
+
+TEST_F(SolverTest, PondersBetweenTheTurns)
+{
+    Solver pondering_solver(Solver::Config{.ponder = true});
+    board.apply_action(pondering_solver.play(board, 20));
+    pondering_solver.ponder();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    board.apply_action(pondering_solver.play(board, 20));
+
+    EXPECT_TRUE(pondering_solver.last_turn().tree_reused);
+    EXPECT_GT(pondering_solver.last_turn().ponder_iterations, 0);
+    EXPECT_GT(pondering_solver.last_turn().inherited_visits, 0);
+}
+
+TEST_F(SolverTest, PlayingWithoutPonderingFirstIsFine)
+{
+    Solver pondering_solver(Solver::Config{.ponder = true});
+    board.apply_action(pondering_solver.play(board, 20));
+    board.apply_action(pondering_solver.play(board, 20));
+
+    EXPECT_TRUE(pondering_solver.last_turn().tree_reused);
+    EXPECT_EQ(pondering_solver.last_turn().ponder_iterations, 0);
+}
+
+} // namespace
@@ -6,6 +6,7 @@
 #include <array>
 #include <cstdint>
 #include <iterator>
+#include <type_traits>
 #include <vector>
 
 template<typename E>
@@ -27,19 +28,30 @@ struct ClusterT;
 namespace sg {
 
 using Key = uint64_t;
-auto inline constexpr N_ZOBRIST_KEYS = (MAX_CELLS + 1) * MAX_COLORS;
+/** One key per cell and color, then one per column. */
+auto inline constexpr N_ZOBRIST_KEYS = MAX_CELLS * MAX_COLORS + WIDTH;
 
 // State descriptor
 typedef std::array<int, MAX_COLORS + 1> ColorCounter;
 using Cluster = ClusterT<Cell, CELL_NONE>;
 
-// Cluster or Action descriptor
+/** The smallest unsigned type able to hold any cell, CELL_NONE included. */
+using PackedCell = std::conditional_t<(CELL_NONE <= UINT8_MAX), uint8_t, uint16_t>;
+
+/**
+ * Cluster or Action descriptor.
+ *
+ * @Note It is packed into a few bytes since the search trees hold one per edge:
+ * a cluster has at most MAX_CELLS cells, so the size fits the same type as the rep.
+ */
 struct ClusterData
 {
-  Cell rep{CELL_NONE};
+  /** The smallest cell of the cluster, so that equal actions have equal descriptors. */
+  PackedCell rep{CELL_NONE};
   Color color{Color::Empty};
-  size_t size{0};
+  PackedCell size{0};
 };
+static_assert(sizeof(ClusterData) <= 4 || MAX_CELLS > UINT8_MAX);
 using ClusterDataVec = std::vector<ClusterData>;
 enum class Output
 {
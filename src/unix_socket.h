@@ -0,0 +1,145 @@
+#ifndef __UNIX_SOCKET_H_
+#define __UNIX_SOCKET_H_
+
+#include <string>
+#include <string_view>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+/**
+ * The few socket calls of the solver daemon and its client, which speak a line
+ * based text protocol over a Unix-domain stream socket.
+ */
+namespace sg::net {
+
+inline bool make_address(const std::string& path, sockaddr_un& addr)
+{
+  if (path.size() >= sizeof(addr.sun_path))
+    return false;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+/**
+ * @Return The listening socket bound to `path` (replacing any file there), -1 on
+ * failure with errno set.
+ */
+inline int listen_at(const std::string& path, int backlog = 64)
+{
+  sockaddr_un addr;
+  if (!make_address(path, addr))
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0
+      || ::listen(fd, backlog) != 0)
+  {
+    const int err = errno;
+    ::close(fd);
+    errno = err;
+    return -1;
+  }
+  return fd;
+}
+
+/** @Return The socket connected to `path`, -1 on failure with errno set. */
+inline int connect_to(const std::string& path)
+{
+  sockaddr_un addr;
+  if (!make_address(path, addr))
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+  {
+    const int err = errno;
+    ::close(fd);
+    errno = err;
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Write the whole data, without raising SIGPIPE if the peer is gone.
+ *
+ * @Return False if the connection is broken.
+ */
+inline bool send_all(int fd, std::string_view data)
+{
+  while (!data.empty())
+  {
+    const ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data.remove_prefix(n);
+  }
+  return true;
+}
+
+/**
+ * Read a socket line by line.
+ */
+class LineReader
+{
+ public:
+  explicit LineReader(int fd) : m_fd(fd) {}
+
+  /**
+   * Read the next line, without its end of line.
+   *
+   * @Return False at the end of the stream (or on error).
+   */
+  bool getline(std::string& line)
+  {
+    while (true)
+    {
+      const size_t eol = m_buffer.find('\n', m_pos);
+      if (eol != std::string::npos)
+      {
+        line.assign(m_buffer, m_pos, eol - m_pos);
+        if (!line.empty() && line.back() == '\r')
+          line.pop_back();
+        m_pos = eol + 1;
+        return true;
+      }
+      m_buffer.erase(0, m_pos);
+      m_pos = 0;
+
+      char chunk[4096];
+      const ssize_t n = ::recv(m_fd, chunk, sizeof(chunk), 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      m_buffer.append(chunk, n);
+    }
+  }
+
+ private:
+  int m_fd;
+  std::string m_buffer;
+  size_t m_pos = 0;
+};
+
+} // namespace sg::net
+
+#endif
@@ -3,50 +3,45 @@
 #define __ZOBRIST_H_
 
 #include <array>
-#include <set>
+#include <cstdint>
+#include <utility>
 #include "rand.h"
 
 namespace zobrist {
 
+/**
+ * A table of NKeys random keys, indexed by HashFunctor. The keys are a splitmix64
+ * sequence from the given seed, so that a constexpr table is baked into the binary.
+ *
+ * The two lowest bits of the keys are clear, so that the xor of keys leaves them
+ * free for flags.
+ */
 template<typename HashFunctor, typename Key, size_t NKeys>
 class KeyTable
 {
  public:
-  KeyTable() : m_keys(populate_keys()) {}
+  explicit constexpr KeyTable(uint64_t seed) : m_keys(populate_keys(seed)) {}
   template<typename... Args>
-  Key operator()(Args&&... args)
+  constexpr Key operator()(Args&&... args) const
   {
     return m_keys[f_hash(std::forward<Args>(args)...)];
   };
-  Key operator[](size_t n) const { return m_keys[n]; }
-  size_t size() const { return NKeys; }
+  constexpr Key operator[](size_t n) const { return m_keys[n]; }
+  constexpr size_t size() const { return NKeys; }
 
  private:
   std::array<Key, NKeys> m_keys;
   HashFunctor f_hash{};
 
-  std::array<Key, NKeys> populate_keys();
+  static constexpr std::array<Key, NKeys> populate_keys(uint64_t seed);
 };
 
 template<typename HashFunctor, typename Key, size_t N>
-std::array<Key, N> KeyTable<HashFunctor, Key, N>::populate_keys()
+constexpr std::array<Key, N> KeyTable<HashFunctor, Key, N>::populate_keys(uint64_t seed)
 {
   std::array<Key, N> ret{};
-  Rand::Util<Key> randutil{};
-  //std::set<Key> distinct_keys {};
-
-  const auto min = std::numeric_limits<Key>::min();
-  const auto max = std::numeric_limits<Key>::max();
-
-  // while (distinct_keys.size() < N) {
-  //     auto [it, inserted] = distinct_keys.insert(randutil.get(min, max));
-  // }
-  // std::copy(distinct_keys.begin(), distinct_keys.end(), ret.begin());
-
-  for (auto i = 0; i < N; ++i)
-  {
-    ret[i] = randutil.get(min, max);
-  }
+  for (auto& key : ret)
+    key = static_cast<Key>(Rand::splitmix64(seed)) & ~Key{3};
   return ret;
 }
 